@@ -0,0 +1,70 @@
+#pragma once
+#include "mesh.h"
+#include "ray.h"
+// Suppress warnings in third-party code.
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct BVHBuildSettings {
+	int maxLeafTriangles { 4 }; // leaves are split while they hold more, if the SAH says it pays off
+	int binCount { 16 }; // SAH candidates per axis
+	bool parallel { false }; // build large subtrees on separate threads
+};
+
+struct BVHHit {
+	uint32_t meshIndex; // into the meshes the BVH was built from
+	uint32_t triangleIndex; // into that mesh's triangles
+	glm::vec2 barycentric; // weights of the triangle's 2nd and 3rd vertex
+};
+
+// Bounding volume hierarchy over the triangles of one or more meshes, for ray
+// queries (picking, visibility) and collision tests.
+//
+// Built top-down with binned SAH, then flattened depth-first into 32-byte
+// nodes where the first child directly follows its parent. Triangles are
+// copied in leaf order as (vertex, edge, edge), so traversal never touches
+// the source meshes, which may be released after building.
+class BVH {
+public:
+	BVH() = default;
+	explicit BVH(std::span<const Mesh> meshes, const BVHBuildSettings& settings = {});
+
+	// Closest hit along the ray up to ray.t. On a hit, shortens ray.t to the
+	// hit distance and fills `hit` when given.
+	bool intersect(Ray& ray, BVHHit* hit = nullptr) const;
+	// True if anything is hit before ray.t; stops at the first hit found.
+	[[nodiscard]] bool intersectAny(const Ray& ray) const;
+
+	[[nodiscard]] bool empty() const { return m_nodes.empty(); }
+	[[nodiscard]] glm::vec3 boundsMin() const;
+	[[nodiscard]] glm::vec3 boundsMax() const;
+	[[nodiscard]] size_t nodeCount() const { return m_nodes.size(); }
+	[[nodiscard]] size_t triangleCount() const { return m_triangles.size(); }
+
+	struct BuildNode; // tree used while building, see bvh.cpp
+
+private:
+	struct Node {
+		glm::vec3 boundsMin;
+		uint32_t offset; // leaf: first triangle, interior: index of the second child
+		glm::vec3 boundsMax;
+		uint16_t count; // triangles in the leaf, 0 for interior nodes
+		uint16_t axis; // split axis of interior nodes, visits the nearer child first
+	};
+	struct Triangle {
+		glm::vec3 v0, edge1, edge2;
+	};
+
+	uint32_t flatten(const BuildNode& node);
+
+	std::vector<Node> m_nodes;
+	std::vector<Triangle> m_triangles; // in leaf order
+	std::vector<uint32_t> m_meshIndices; // per triangle in leaf order
+	std::vector<uint32_t> m_triangleIndices; // per triangle in leaf order
+};
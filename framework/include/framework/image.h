@@ -7,13 +7,18 @@ DISABLE_WARNINGS_PUSH()
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 DISABLE_WARNINGS_POP()
+#include <cassert>
+#include <cstdint>
 #include <filesystem>
-#include <vector>
+#include <memory>
 
 
 struct Image {
 public:
-    explicit Image(const std::filesystem::path& filePath);
+    // Decodes the file with stb_image. desiredChannels = 0 keeps the file's
+    // channel count, otherwise pixels are converted to that many channels.
+    // Throws if the file can't be read.
+    explicit Image(const std::filesystem::path& filePath, int desiredChannels = 0);
 
 
     void writeBitmapToFile(const std::filesystem::path& filePath);
@@ -42,9 +47,19 @@ public:
     }
 
     uint8_t* get_data() {
-        return pixels.data();
+        return pixels.get();
+    }
+    const uint8_t* get_data() const {
+        return pixels.get();
+    }
+    size_t get_byte_size() const {
+        return size_t(width) * size_t(height) * size_t(channels);
     }
 
 private:
-    std::vector<uint8_t> pixels;
+    struct StbDeleter {
+        void operator()(uint8_t* stbPixels) const;
+    };
+    // The buffer decoded by stb_image, owned rather than copied
+    std::unique_ptr<uint8_t[], StbDeleter> pixels;
 };
@@ -6,6 +6,7 @@ DISABLE_WARNINGS_PUSH()
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 DISABLE_WARNINGS_POP()
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <span>
@@ -50,6 +51,7 @@ struct MeshGL {
 	GLuint ibo = 0;
 	size_t indexCount = 0;
 	std::string materialName;
+	uint32_t materialId = 0; // index into the owner's material table
 };
 
 struct LoadMeshSettings {
@@ -59,6 +61,10 @@ struct LoadMeshSettings {
 
 [[nodiscard]] std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSettings& settings = {});
 [[nodiscard]] Mesh mergeMeshes(std::span<const Mesh> meshes);
+// Simplifies the mesh by vertex clustering: vertices in the same grid cell of
+// size cellSize (and facing roughly the same way) are merged and triangles
+// that collapse are removed. Meant for distant levels of detail.
+[[nodiscard]] Mesh simplifyMesh(const Mesh& mesh, float cellSize);
 void meshFlipX(Mesh& mesh);
 void meshFlipY(Mesh& mesh);
 void meshFlipZ(Mesh& mesh);
\ No newline at end of file
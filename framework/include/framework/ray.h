@@ -2,8 +2,10 @@
 #include "disable_all_warnings.h"
 // Suppress warnings in third-party code.
 DISABLE_WARNINGS_PUSH()
+#include <glm/geometric.hpp>
 #include <glm/vec3.hpp>
 DISABLE_WARNINGS_POP()
+#include <cmath>
 #include <limits>
 
 struct Ray {
@@ -11,3 +13,27 @@ struct Ray {
     glm::vec3 direction { 0.0f, 0.0f, -1.0f };
     float t { std::numeric_limits<float>::max() };
 };
+
+// Intersects the ray with a solid sphere. On a hit before ray.t, shortens
+// ray.t to the hit and returns true; a ray starting inside hits at t = 0.
+// The direction doesn't need to be normalized.
+inline bool intersectRayWithSphere(Ray& ray, const glm::vec3& center, float radius)
+{
+    const glm::vec3 offset = ray.origin - center;
+    const float a = glm::dot(ray.direction, ray.direction);
+    const float halfB = glm::dot(offset, ray.direction);
+    const float c = glm::dot(offset, offset) - radius * radius;
+    if (c <= 0.0f) {
+        ray.t = 0.0f;
+        return true;
+    }
+    const float discriminant = halfB * halfB - a * c;
+    if (halfB >= 0.0f || discriminant < 0.0f)
+        return false; // pointing away or passing by
+
+    const float t = (-halfB - std::sqrt(discriminant)) / a;
+    if (t >= ray.t)
+        return false;
+    ray.t = t;
+    return true;
+}
@@ -10,6 +10,7 @@ DISABLE_WARNINGS_PUSH()
 DISABLE_WARNINGS_POP()
 #include <exception>
 #include <filesystem>
+#include <string>
 #include <vector>
 
 struct ShaderLoadingException : public std::runtime_error {
@@ -53,6 +54,8 @@ public:
     ~ShaderBuilder();
 
     ShaderBuilder& addStage(GLuint shaderStage, std::filesystem::path shaderFile);
+    // Outputs captured by transform feedback, in buffer order. Must be set before build().
+    ShaderBuilder& setTransformFeedbackVaryings(std::vector<std::string> varyings, GLenum bufferMode = GL_INTERLEAVED_ATTRIBS);
     Shader build();
 
 private:
@@ -60,4 +63,6 @@ private:
 
 private:
     std::vector<GLuint> m_shaders;
+    std::vector<std::string> m_feedbackVaryings;
+    GLenum m_feedbackBufferMode = GL_INTERLEAVED_ATTRIBS;
 };
@@ -0,0 +1,367 @@
+#include "bvh.h"
+// Suppress warnings in third-party code.
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <future>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace {
+
+struct Reference {
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 centroid;
+    uint32_t meshIndex;
+    uint32_t triangleIndex;
+};
+
+struct Bounds {
+    glm::vec3 lower { std::numeric_limits<float>::max() };
+    glm::vec3 upper { std::numeric_limits<float>::lowest() };
+
+    void grow(const glm::vec3& p)
+    {
+        lower = glm::min(lower, p);
+        upper = glm::max(upper, p);
+    }
+    void grow(const Bounds& b)
+    {
+        lower = glm::min(lower, b.lower);
+        upper = glm::max(upper, b.upper);
+    }
+    float halfArea() const
+    {
+        const glm::vec3 d = glm::max(upper - lower, glm::vec3(0.0f));
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+// Subtrees with fewer triangles are built on the calling thread
+constexpr size_t PARALLEL_MIN_TRIANGLES = 8192;
+constexpr int MAX_STACK_DEPTH = 64;
+// Leaves over the 16 bit count limit are median split this many levels above
+// the depth cap: 17 halvings take any 32 bit triangle count below the limit
+constexpr int MEDIAN_SPLIT_LEVELS = 17;
+
+}
+
+struct BVH::BuildNode {
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    std::unique_ptr<BuildNode> children[2];
+    uint32_t first = 0;
+    uint32_t count = 0; // 0 for interior nodes
+    int axis = 0;
+};
+
+namespace {
+
+using BuildNode = BVH::BuildNode;
+
+struct Builder {
+    std::vector<Reference>& refs;
+    const BVHBuildSettings& settings;
+    int parallelDepth;
+
+    std::unique_ptr<BuildNode> makeLeaf(const Bounds& bounds, size_t begin, size_t end) const
+    {
+        auto node = std::make_unique<BuildNode>();
+        node->boundsMin = bounds.lower;
+        node->boundsMax = bounds.upper;
+        node->first = static_cast<uint32_t>(begin);
+        node->count = static_cast<uint32_t>(end - begin);
+        assert(node->count <= std::numeric_limits<uint16_t>::max());
+        return node;
+    }
+
+    std::unique_ptr<BuildNode> build(size_t begin, size_t end, int depth) const
+    {
+        Bounds bounds, centroidBounds;
+        for (size_t i = begin; i < end; i++) {
+            bounds.grow(Bounds { refs[i].boundsMin, refs[i].boundsMax });
+            centroidBounds.grow(refs[i].centroid);
+        }
+        const size_t count = end - begin;
+        // leaves store their size in 16 bits; traversal has a fixed stack, so
+        // the depth is capped (only degenerate inputs get near it). Nodes too
+        // large for a leaf switch to median splits before the cap.
+        const bool mustSplit = count > std::numeric_limits<uint16_t>::max();
+        if (!mustSplit && (count <= static_cast<size_t>(settings.maxLeafTriangles) || depth >= MAX_STACK_DEPTH - 1))
+            return makeLeaf(bounds, begin, end);
+        const bool medianSplit = mustSplit && depth >= MAX_STACK_DEPTH - 1 - MEDIAN_SPLIT_LEVELS;
+
+        // Binned SAH: cost = 1 (traversal) + triangles weighted by the area of their child
+        const size_t binCount = static_cast<size_t>(std::max(settings.binCount, 2));
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        size_t bestSplit = 0;
+        std::vector<Bounds> bins(binCount), rightBounds(binCount);
+        std::vector<size_t> binCounts(binCount);
+        for (int axis = 0; axis < 3 && !medianSplit; axis++) {
+            const float extent = centroidBounds.upper[axis] - centroidBounds.lower[axis];
+            if (extent <= 0.0f)
+                continue;
+            std::fill(bins.begin(), bins.end(), Bounds {});
+            std::fill(binCounts.begin(), binCounts.end(), 0);
+            const float scale = static_cast<float>(binCount) / extent;
+            for (size_t i = begin; i < end; i++) {
+                const size_t b = std::min(binCount - 1, static_cast<size_t>((refs[i].centroid[axis] - centroidBounds.lower[axis]) * scale));
+                bins[b].grow(Bounds { refs[i].boundsMin, refs[i].boundsMax });
+                binCounts[b]++;
+            }
+
+            Bounds right;
+            for (size_t b = binCount - 1; b > 0; b--) {
+                right.grow(bins[b]);
+                rightBounds[b] = right;
+            }
+            Bounds left;
+            size_t leftCount = 0;
+            for (size_t split = 1; split < binCount; split++) {
+                left.grow(bins[split - 1]);
+                leftCount += binCounts[split - 1];
+                const size_t rightCount = count - leftCount;
+                if (leftCount == 0 || rightCount == 0)
+                    continue;
+                const float cost = 1.0f + (static_cast<float>(leftCount) * left.halfArea() + static_cast<float>(rightCount) * rightBounds[split].halfArea()) / bounds.halfArea();
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        size_t middle;
+        if (bestAxis >= 0 && !medianSplit && (bestCost < static_cast<float>(count) || mustSplit)) {
+            const float lower = centroidBounds.lower[bestAxis];
+            const float scale = static_cast<float>(binCount) / (centroidBounds.upper[bestAxis] - lower);
+            auto splitPoint = std::partition(refs.begin() + static_cast<std::ptrdiff_t>(begin), refs.begin() + static_cast<std::ptrdiff_t>(end), [&](const Reference& ref) {
+                return std::min(binCount - 1, static_cast<size_t>((ref.centroid[bestAxis] - lower) * scale)) < bestSplit;
+            });
+            middle = static_cast<size_t>(splitPoint - refs.begin());
+        } else if (mustSplit) {
+            // near the depth cap, or all centroids coincide: halve along the
+            // widest centroid axis
+            const glm::vec3 extent = centroidBounds.upper - centroidBounds.lower;
+            bestAxis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            middle = begin + count / 2;
+            std::nth_element(refs.begin() + static_cast<std::ptrdiff_t>(begin), refs.begin() + static_cast<std::ptrdiff_t>(middle), refs.begin() + static_cast<std::ptrdiff_t>(end), [&](const Reference& a, const Reference& b) {
+                return a.centroid[bestAxis] < b.centroid[bestAxis];
+            });
+        } else {
+            return makeLeaf(bounds, begin, end);
+        }
+
+        auto node = std::make_unique<BuildNode>();
+        node->boundsMin = bounds.lower;
+        node->boundsMax = bounds.upper;
+        node->axis = bestAxis;
+        if (depth < parallelDepth && count >= PARALLEL_MIN_TRIANGLES) {
+            auto left = std::async(std::launch::async, [&]() { return build(begin, middle, depth + 1); });
+            node->children[1] = build(middle, end, depth + 1);
+            node->children[0] = left.get();
+        } else {
+            node->children[0] = build(begin, middle, depth + 1);
+            node->children[1] = build(middle, end, depth + 1);
+        }
+        return node;
+    }
+};
+
+// Distance to the box along the ray, or false if it's missed before maxT
+bool intersectBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& origin, const glm::vec3& invDirection, float maxT)
+{
+    const glm::vec3 t0 = (boundsMin - origin) * invDirection;
+    const glm::vec3 t1 = (boundsMax - origin) * invDirection;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar = glm::max(t0, t1);
+    const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+    return enter <= exit;
+}
+
+}
+
+BVH::BVH(std::span<const Mesh> meshes, const BVHBuildSettings& settings)
+{
+    std::vector<Reference> refs;
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const Mesh& mesh = meshes[m];
+        for (size_t t = 0; t < mesh.triangles.size(); t++) {
+            const glm::uvec3& tri = mesh.triangles[t];
+            Reference ref;
+            ref.boundsMin = ref.boundsMax = mesh.vertices[tri[0]].position;
+            for (int k = 1; k < 3; k++) {
+                ref.boundsMin = glm::min(ref.boundsMin, mesh.vertices[tri[k]].position);
+                ref.boundsMax = glm::max(ref.boundsMax, mesh.vertices[tri[k]].position);
+            }
+            ref.centroid = 0.5f * (ref.boundsMin + ref.boundsMax);
+            ref.meshIndex = static_cast<uint32_t>(m);
+            ref.triangleIndex = static_cast<uint32_t>(t);
+            refs.push_back(ref);
+        }
+    }
+    if (refs.empty())
+        return;
+
+    int parallelDepth = 0;
+    if (settings.parallel) {
+        // enough subtrees for every hardware thread, and some slack for imbalance
+        for (unsigned threads = std::max(std::thread::hardware_concurrency(), 1u); threads > 1; threads /= 2)
+            parallelDepth++;
+        parallelDepth += 1;
+    }
+    const Builder builder { refs, settings, parallelDepth };
+    const std::unique_ptr<BuildNode> root = builder.build(0, refs.size(), 0);
+
+    m_triangles.reserve(refs.size());
+    m_meshIndices.reserve(refs.size());
+    m_triangleIndices.reserve(refs.size());
+    for (const Reference& ref : refs) {
+        const Mesh& mesh = meshes[ref.meshIndex];
+        const glm::uvec3& tri = mesh.triangles[ref.triangleIndex];
+        const glm::vec3 v0 = mesh.vertices[tri[0]].position;
+        m_triangles.push_back({ v0, mesh.vertices[tri[1]].position - v0, mesh.vertices[tri[2]].position - v0 });
+        m_meshIndices.push_back(ref.meshIndex);
+        m_triangleIndices.push_back(ref.triangleIndex);
+    }
+    flatten(*root);
+}
+
+// Appends the subtree depth-first and returns the index of its root
+uint32_t BVH::flatten(const BuildNode& node)
+{
+    const uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back({ node.boundsMin, node.first, node.boundsMax, static_cast<uint16_t>(node.count), static_cast<uint16_t>(node.axis) });
+    if (node.count == 0) {
+        flatten(*node.children[0]);
+        const uint32_t second = flatten(*node.children[1]);
+        m_nodes[index].offset = second;
+    }
+    return index;
+}
+
+glm::vec3 BVH::boundsMin() const
+{
+    return m_nodes.empty() ? glm::vec3(0.0f) : m_nodes[0].boundsMin;
+}
+
+glm::vec3 BVH::boundsMax() const
+{
+    return m_nodes.empty() ? glm::vec3(0.0f) : m_nodes[0].boundsMax;
+}
+
+// Möller-Trumbore; t and the barycentric coordinates of the hit
+static bool intersectTriangle(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2, const Ray& ray, float& t, glm::vec2& barycentric)
+{
+    const glm::vec3 p = glm::cross(ray.direction, edge2);
+    const float determinant = glm::dot(edge1, p);
+    if (std::abs(determinant) < 1e-12f)
+        return false; // parallel to the triangle
+    const float inverse = 1.0f / determinant;
+    const glm::vec3 s = ray.origin - v0;
+    const float u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    const glm::vec3 q = glm::cross(s, edge1);
+    const float v = glm::dot(ray.direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    t = glm::dot(edge2, q) * inverse;
+    barycentric = glm::vec2(u, v);
+    return t > 0.0f && t < ray.t;
+}
+
+bool BVH::intersect(Ray& ray, BVHHit* hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    const glm::vec3 invDirection = 1.0f / ray.direction;
+    const bool directionNegative[3] = { invDirection.x < 0.0f, invDirection.y < 0.0f, invDirection.z < 0.0f };
+    std::array<uint32_t, MAX_STACK_DEPTH> stack;
+    size_t stackSize = 0;
+    uint32_t current = 0;
+    uint32_t hitTriangle = std::numeric_limits<uint32_t>::max();
+    glm::vec2 hitBarycentric;
+
+    while (true) {
+        const Node& node = m_nodes[current];
+        if (intersectBox(node.boundsMin, node.boundsMax, ray.origin, invDirection, ray.t)) {
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                    const Triangle& tri = m_triangles[i];
+                    float t;
+                    glm::vec2 barycentric;
+                    if (intersectTriangle(tri.v0, tri.edge1, tri.edge2, ray, t, barycentric)) {
+                        ray.t = t;
+                        hitTriangle = i;
+                        hitBarycentric = barycentric;
+                    }
+                }
+            } else {
+                // near child first, so far subtrees get culled by the shorter ray
+                if (directionNegative[node.axis]) {
+                    stack[stackSize++] = current + 1;
+                    current = node.offset;
+                } else {
+                    stack[stackSize++] = node.offset;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+        if (stackSize == 0)
+            break;
+        current = stack[--stackSize];
+    }
+
+    if (hitTriangle == std::numeric_limits<uint32_t>::max())
+        return false;
+    if (hit)
+        *hit = BVHHit { m_meshIndices[hitTriangle], m_triangleIndices[hitTriangle], hitBarycentric };
+    return true;
+}
+
+bool BVH::intersectAny(const Ray& ray) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    const glm::vec3 invDirection = 1.0f / ray.direction;
+    std::array<uint32_t, MAX_STACK_DEPTH> stack;
+    size_t stackSize = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const Node& node = m_nodes[current];
+        if (intersectBox(node.boundsMin, node.boundsMax, ray.origin, invDirection, ray.t)) {
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                    const Triangle& tri = m_triangles[i];
+                    float t;
+                    glm::vec2 barycentric;
+                    if (intersectTriangle(tri.v0, tri.edge1, tri.edge2, ray, t, barycentric))
+                        return true;
+                }
+            } else {
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+                continue;
+            }
+        }
+        if (stackSize == 0)
+            break;
+        current = stack[--stackSize];
+    }
+    return false;
+}
@@ -16,11 +16,16 @@ DISABLE_WARNINGS_POP()
 // write image to a file
 void Image::writeBitmapToFile(const std::filesystem::path& filePath) {
     std::string filePathString = filePath.string();
-    stbi_write_bmp(filePathString.c_str(), width, height, channels, pixels.data());
+    stbi_write_bmp(filePathString.c_str(), width, height, channels, pixels.get());
+}
+
+void Image::StbDeleter::operator()(uint8_t* stbPixels) const
+{
+	stbi_image_free(stbPixels);
 }
 
 // Image constructor, create image from file
-Image::Image(const std::filesystem::path& filePath)
+Image::Image(const std::filesystem::path& filePath, int desiredChannels)
 {
 	if (!std::filesystem::exists(filePath)) {
 		std::cerr << "Texture file " << filePath << " does not exist!" << std::endl;
@@ -28,14 +33,13 @@ Image::Image(const std::filesystem::path& filePath)
 	}
 
 	const auto filePathStr = filePath.string(); // Create l-value so c_str() is safe.
-	stbi_uc* stbPixels = stbi_load(filePathStr.c_str(), &width, &height, &channels, STBI_default);
+	pixels.reset(stbi_load(filePathStr.c_str(), &width, &height, &channels, desiredChannels));
 
-	if (!stbPixels) {
+	if (!pixels) {
 		std::cerr << "Failed to read texture " << filePath << " using stb_image.h" << std::endl;
 		throw std::exception();
 	}
-
-	for (size_t i = 0UL; i < width * height * channels; i++) { pixels.emplace_back(stbPixels[i]); }
-
-	stbi_image_free(stbPixels);
+	// stb reports the channels of the file, the buffer has the requested ones
+	if (desiredChannels != STBI_default)
+		channels = desiredChannels;
 }
@@ -10,6 +10,7 @@ DISABLE_WARNINGS_POP()
 #include <algorithm>
 #include <cassert>
 #include <exception>
+#include <future>
 #include <iostream>
 #include <numeric>
 #include <span>
@@ -17,6 +18,7 @@ DISABLE_WARNINGS_POP()
 #include <string>
 #include <tuple>
 #include <map>
+#include <unordered_map>
 
 static void centerAndScaleToUnitMesh(std::span<Mesh> meshes);
 
@@ -69,6 +71,18 @@ std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSett
         throw std::exception();
     }
 
+    // Decode every distinct diffuse texture once, all in parallel and while
+    // the geometry below is processed. Sub-meshes using it share the Image.
+    std::map<std::string, std::shared_future<std::shared_ptr<Image>>> kdTextures;
+    for (const auto& objMaterial : inMaterials) {
+        if (objMaterial.diffuse_texname.empty() || kdTextures.contains(objMaterial.diffuse_texname))
+            continue;
+        const auto texturePath = baseDir / objMaterial.diffuse_texname;
+        kdTextures[objMaterial.diffuse_texname] = std::async(std::launch::async, [texturePath]() {
+            return std::make_shared<Image>(texturePath);
+        }).share();
+    }
+
     std::vector<Mesh> out;
     for (const auto& shape : inShapes) {
         assert(shape.mesh.indices.size() % 3 == 0);
@@ -131,7 +145,7 @@ std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSett
                 const auto& objMaterial = inMaterials[materialID];
                 mesh.material.kd = construct_vec3(objMaterial.diffuse);
                 if (!objMaterial.diffuse_texname.empty()) {
-                    mesh.material.kdTexture = std::make_shared<Image>(baseDir / objMaterial.diffuse_texname);
+                    mesh.material.kdTexture = kdTextures.at(objMaterial.diffuse_texname).get();
                 }
                 mesh.material.ks = construct_vec3(objMaterial.specular);
                 mesh.material.shininess = objMaterial.shininess;
@@ -194,6 +208,75 @@ Mesh mergeMeshes(std::span<const Mesh> meshes)
     return out;
 }
 
+// Grid cell and normal bucket of a vertex in simplifyMesh
+struct ClusterKey {
+    glm::ivec3 cell;
+    int normalBucket;
+
+    bool operator==(const ClusterKey&) const = default;
+};
+
+struct ClusterKeyHash {
+    size_t operator()(const ClusterKey& key) const
+    {
+        size_t seed = 0;
+        hash_combine(seed, key.cell.x);
+        hash_combine(seed, key.cell.y);
+        hash_combine(seed, key.cell.z);
+        hash_combine(seed, key.normalBucket);
+        return seed;
+    }
+};
+
+Mesh simplifyMesh(const Mesh& mesh, float cellSize)
+{
+    // Dominant axis and sign of the normal, so hard edges stay separate
+    const auto normalBucket = [](const glm::vec3& n) {
+        const glm::vec3 a = glm::abs(n);
+        const int axis = a.x >= a.y && a.x >= a.z ? 0 : (a.y >= a.z ? 1 : 2);
+        return axis * 2 + (n[axis] < 0.0f ? 1 : 0);
+    };
+    const auto clusterKey = [&](const Vertex& v) {
+        return ClusterKey { glm::ivec3(glm::floor(v.position / cellSize)), normalBucket(v.normal) };
+    };
+
+    Mesh out;
+    out.material = mesh.material;
+
+    // Cluster per vertex, representatives are the cluster averages
+    std::unordered_map<ClusterKey, unsigned, ClusterKeyHash> clusters;
+    std::vector<unsigned> remap(mesh.vertices.size());
+    std::vector<unsigned> clusterSize;
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const Vertex& v = mesh.vertices[i];
+        auto [it, inserted] = clusters.try_emplace(clusterKey(v), (unsigned)out.vertices.size());
+        if (inserted) {
+            out.vertices.push_back(Vertex { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f) });
+            clusterSize.push_back(0);
+        }
+        Vertex& cluster = out.vertices[it->second];
+        cluster.position += v.position;
+        cluster.normal += v.normal;
+        cluster.texCoord += v.texCoord;
+        clusterSize[it->second]++;
+        remap[i] = it->second;
+    }
+    for (size_t i = 0; i < out.vertices.size(); i++) {
+        Vertex& v = out.vertices[i];
+        v.position /= (float)clusterSize[i];
+        v.texCoord /= (float)clusterSize[i];
+        const float length = glm::length(v.normal);
+        v.normal = length > 0.0f ? v.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    for (const glm::uvec3& tri : mesh.triangles) {
+        const glm::uvec3 t { remap[tri.x], remap[tri.y], remap[tri.z] };
+        if (t.x != t.y && t.y != t.z && t.x != t.z)
+            out.triangles.push_back(t);
+    }
+    return out;
+}
+
 void meshFlipX(Mesh& mesh)
 {
     for (auto& v : mesh.vertices) {
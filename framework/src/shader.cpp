@@ -107,12 +107,26 @@ ShaderBuilder& ShaderBuilder::addStage(GLuint shaderStage, std::filesystem::path
     return *this;
 }
 
+ShaderBuilder& ShaderBuilder::setTransformFeedbackVaryings(std::vector<std::string> varyings, GLenum bufferMode)
+{
+    m_feedbackVaryings = std::move(varyings);
+    m_feedbackBufferMode = bufferMode;
+    return *this;
+}
+
 Shader ShaderBuilder::build()
 {
     // Combine vertex and fragment shaders into a single shader program.
     GLuint program = glCreateProgram();
     for (GLuint shader : m_shaders)
         glAttachShader(program, shader);
+
+    if (!m_feedbackVaryings.empty()) {
+        std::vector<const char*> names;
+        for (const std::string& varying : m_feedbackVaryings)
+            names.push_back(varying.c_str());
+        glTransformFeedbackVaryings(program, static_cast<GLsizei>(names.size()), names.data(), m_feedbackBufferMode);
+    }
     glLinkProgram(program);
 
     if (!checkProgramErrors(program)) {
@@ -0,0 +1,25 @@
+#version 410 core
+
+// View/projection matrix, the model matrix comes per instance
+uniform mat4 view;
+uniform mat4 projection;
+
+// Per-vertex attributes
+layout(location=0) in vec3 pos;
+layout(location=1) in vec3 normal;
+// Per-instance attributes
+layout(location=3) in mat4 instanceModel;
+
+// Data to pass to fragment shader
+out vec4 fragWorldPos;
+out vec3 fragPos;
+out vec3 fragNormal;
+
+void main() {
+    fragWorldPos = instanceModel * vec4(pos, 1.0);
+    gl_Position = projection * view * fragWorldPos;
+
+    // Pass position and normal through to fragment shader
+    fragPos = pos;
+    fragNormal = normal;
+}
@@ -0,0 +1,18 @@
+#version 410 core
+
+// Particle fragment output for weighted blended OIT, see WeightedOIT.
+in  vec4 vColor;
+layout(location = 0) out vec4 accum;
+layout(location = 1) out float revealage;
+
+void main()
+{
+    vec4 color = vColor;
+
+    // Depth weight from McGuire & Bavoil, eq. 10
+    float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 *
+                         pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+
+    accum = vec4(color.rgb * color.a, color.a) * weight;
+    revealage = color.a;
+}
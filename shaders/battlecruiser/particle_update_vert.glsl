@@ -0,0 +1,122 @@
+#version 410 core
+
+// One vertex per particle slot, run with GL_RASTERIZER_DISCARD and the
+// outputs captured by transform feedback into the other state buffer.
+layout(location = 0) in vec4 inPositionSize; // xyz = position, w = size (0 = dead)
+layout(location = 1) in vec4 inVelocityLife; // xyz = velocity, w = remaining life
+layout(location = 2) in vec4 inColor;        // rgb, a = fade
+layout(location = 3) in vec2 inFadeGrowth;   // x = seconds of life it fades out over, y = size change per second
+
+out vec4 outPositionSize;
+out vec4 outVelocityLife;
+out vec4 outColor;
+out vec2 outFadeGrowth;
+
+// Must match GpuParticles::MAX_EMITTERS and GpuParticles::EmitterBlock. The
+// spawn parameters mean the same as in ParticleSpawnParams.
+#define MAX_EMITTERS 16
+layout(std140) uniform Emitters {
+    mat4 emitterModel;                    // ship model matrix
+    vec4 emitterOrigins[MAX_EMITTERS];    // xyz = position in model space, w = spawn radius
+    vec4 emitterLifetimes[MAX_EMITTERS];  // life, life deviation, fade out, cone angle (degrees)
+    vec4 emitterSizes[MAX_EMITTERS];      // size, size deviation, size growth, shape
+    vec4 emitterVelocities[MAX_EMITTERS]; // xyz = initial velocity in model space, w = velocity spread
+    vec4 emitterColorsRG[MAX_EMITTERS];   // [min, max] red, [min, max] green in 0..255
+    vec4 emitterColorsB[MAX_EMITTERS];    // xy = [min, max] blue
+    ivec4 emitterInfo;                    // x = emitter count, y = first spawn slot, z = spawn count, w = frame seed
+};
+
+// ParticleSpawnShape
+const int SHAPE_POINT = 0;
+const int SHAPE_DISC = 1;
+const int SHAPE_SPHERE = 2;
+
+uniform float dt;
+uniform int capacity;
+
+const float TWO_PI = 6.28318530718;
+
+// PCG hash
+uint hash(uint x) {
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random01(inout uint seed) {
+    seed = hash(seed);
+    return float(seed) * (1.0 / 4294967296.0);
+}
+
+void spawn(int emitter, inout uint seed) {
+    vec4 lifetime = emitterLifetimes[emitter];
+    vec4 sizes = emitterSizes[emitter];
+    float particleLife = lifetime.x + random01(seed) * lifetime.y;
+
+    // spatial spread over the spawn shape
+    float spawnRadius = emitterOrigins[emitter].w;
+    int shape = int(sizes.w);
+    float angle = TWO_PI * random01(seed);
+    vec3 offset = vec3(0.0);
+    if (shape == SHAPE_DISC) {
+        float radius = spawnRadius * sqrt(random01(seed));
+        offset = vec3(radius * cos(angle), radius * sin(angle), 0.0);
+    } else if (shape == SHAPE_SPHERE) {
+        float radius = spawnRadius * pow(random01(seed), 1.0 / 3.0);
+        float z = 2.0 * random01(seed) - 1.0;
+        float ring = sqrt(max(1.0 - z * z, 0.0));
+        offset = radius * vec3(ring * cos(angle), ring * sin(angle), z);
+    }
+    vec3 spawnPosLocal = emitterOrigins[emitter].xyz + offset;
+    vec3 position = (emitterModel * vec4(spawnPosLocal, 1.0)).xyz;
+
+    // cone directional spread
+    float cosTheta = 1.0 - random01(seed) * (1.0 - cos(radians(lifetime.w)));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    float phi = TWO_PI * random01(seed);
+    vec3 dir = vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+
+    mat3 rotation = mat3(emitterModel);
+    vec3 jitter = (vec3(random01(seed), random01(seed), random01(seed)) - 0.5) * emitterVelocities[emitter].w;
+    vec3 velocity = rotation * dir + rotation * emitterVelocities[emitter].xyz + jitter;
+
+    vec4 colorRG = emitterColorsRG[emitter];
+    vec2 colorB = emitterColorsB[emitter].xy;
+    vec3 color = vec3(mix(colorRG.x, colorRG.y, random01(seed)),
+                      mix(colorRG.z, colorRG.w, random01(seed)),
+                      mix(colorB.x, colorB.y, random01(seed))) / 255.0;
+    float particleSize = sizes.x + random01(seed) * sizes.y;
+
+    outPositionSize = vec4(position, particleSize);
+    outVelocityLife = vec4(velocity, particleLife);
+    outColor = vec4(color, 1.0);
+    outFadeGrowth = vec2(lifetime.z, sizes.z);
+}
+
+void main()
+{
+    // Slots [first spawn slot, + spawn count) of the ring are (re)spawned
+    // this frame, oldest particles first.
+    int spawnIndex = (gl_VertexID - emitterInfo.y + capacity) % capacity;
+    if (spawnIndex < emitterInfo.z && emitterInfo.x > 0) {
+        uint seed = hash(uint(gl_VertexID) ^ hash(uint(emitterInfo.w)));
+        spawn(spawnIndex % emitterInfo.x, seed);
+        return;
+    }
+
+    float particleLife = inVelocityLife.w - dt;
+    if (particleLife > 0.0 && inPositionSize.w > 0.0) {
+        vec3 velocity = inVelocityLife.xyz * (1.0 + dt * 0.5);
+        float particleSize = max(inPositionSize.w + inFadeGrowth.y * dt, 0.0);
+        outPositionSize = vec4(inPositionSize.xyz + velocity * dt, particleSize);
+        outVelocityLife = vec4(velocity, particleLife);
+        outColor = vec4(inColor.rgb, clamp(particleLife / max(inFadeGrowth.x, 1e-6), 0.0, 1.0));
+        outFadeGrowth = inFadeGrowth;
+    } else {
+        // dead: zero size makes the billboard degenerate
+        outPositionSize = vec4(inPositionSize.xyz, 0.0);
+        outVelocityLife = vec4(0.0);
+        outColor = vec4(0.0);
+        outFadeGrowth = vec2(0.0);
+    }
+}
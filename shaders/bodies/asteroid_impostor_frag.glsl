@@ -0,0 +1,37 @@
+#version 410 core
+
+in vec2 vCorner;
+in vec3 vCenter;
+flat in float vSeed;
+
+layout(location = 0) out vec4 fragColor;
+
+uniform mat4 view;
+uniform vec3 cameraWorldPos;
+uniform vec3 lightPosition;
+
+vec3 asteroidAlbedo(float seed) {
+    return mix(vec3(0.35, 0.32, 0.30), vec3(0.55, 0.47, 0.40), seed);
+}
+
+void main()
+{
+    // Lumpy silhouette: the edge radius varies with the angle around the center
+    float angle = atan(vCorner.y, vCorner.x);
+    float edge = 0.85 + 0.08 * sin(3.0 * angle + vSeed * 6.2831)
+                      + 0.05 * sin(5.0 * angle + vSeed * 17.0);
+    float r2 = dot(vCorner, vCorner);
+    if (r2 > edge * edge) discard;
+
+    // Reconstruct a sphere normal from the quad position
+    vec3 cameraRight = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 cameraUp = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 toCamera = normalize(cameraWorldPos - vCenter);
+    vec2 p = vCorner / edge;
+    vec3 normal = normalize(cameraRight * p.x + cameraUp * p.y +
+                            toCamera * sqrt(max(1.0 - dot(p, p), 0.0)));
+
+    vec3 lightDir = normalize(lightPosition - vCenter);
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    fragColor = vec4(asteroidAlbedo(vSeed) * (0.1 + 0.9 * diffuse), 1.0);
+}
@@ -0,0 +1,32 @@
+#version 410 core
+
+// Quad corners (-1,-1) .. (1,1)
+layout(location = 0) in vec2 quadCorner;
+// Per-instance
+layout(location = 3) in vec4 inPositionSize; // xyz = center, w = radius
+
+out vec2 vCorner;
+out vec3 vCenter;
+flat out float vSeed;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+float asteroidSeed(float size) {
+    return fract(sin(size * 12.9898 * 1000.0) * 43758.5453);
+}
+
+void main()
+{
+    vec3 center = inPositionSize.xyz;
+    float size = inPositionSize.w;
+
+    vec3 cameraRight = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 cameraUp = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 worldPos = center + (cameraRight * quadCorner.x + cameraUp * quadCorner.y) * size;
+
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+    vCorner = quadCorner;
+    vCenter = center;
+    vSeed = asteroidSeed(size);
+}
@@ -0,0 +1,22 @@
+#version 410 core
+
+in vec3 fragPosition;
+flat in float vSeed;
+
+layout(location = 0) out vec4 fragColor;
+
+uniform vec3 lightPosition;
+
+vec3 asteroidAlbedo(float seed) {
+    return mix(vec3(0.35, 0.32, 0.30), vec3(0.55, 0.47, 0.40), seed);
+}
+
+void main()
+{
+    // Faceted look: per-triangle normal from screen-space derivatives
+    vec3 normal = normalize(cross(dFdx(fragPosition), dFdy(fragPosition)));
+
+    vec3 lightDir = normalize(lightPosition - fragPosition);
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    fragColor = vec4(asteroidAlbedo(vSeed) * (0.1 + 0.9 * diffuse), 1.0);
+}
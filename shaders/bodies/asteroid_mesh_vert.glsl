@@ -0,0 +1,34 @@
+#version 410 core
+
+// Unit icosphere
+layout(location = 0) in vec3 position;
+// Per-instance
+layout(location = 3) in vec4 inPositionSize; // xyz = center, w = radius
+
+out vec3 fragPosition;
+flat out float vSeed;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+float asteroidSeed(float size) {
+    return fract(sin(size * 12.9898 * 1000.0) * 43758.5453);
+}
+
+void main()
+{
+    vec3 center = inPositionSize.xyz;
+    float size = inPositionSize.w;
+    float seed = asteroidSeed(size);
+
+    // Cheap per-asteroid lumps: a few seed dependent waves over the sphere
+    vec3 k1 = normalize(vec3(seed - 0.5, 1.0, seed * 0.7)) * 3.0;
+    vec3 k2 = normalize(vec3(1.0, seed * 1.3 - 0.6, 0.4 - seed)) * 5.0;
+    float lump = 1.0 + 0.18 * sin(dot(position, k1) + seed * 6.2831)
+                     + 0.10 * sin(dot(position, k2) + seed * 17.0);
+
+    vec3 worldPos = center + position * lump * size;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+    fragPosition = worldPos;
+    vSeed = seed;
+}
@@ -0,0 +1,10 @@
+#version 410 core
+
+in vec4 vColor;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = vColor;
+}
@@ -0,0 +1,43 @@
+#version 410 core
+
+// Per-asteroid data, drawn as GL_POINTS
+layout(location = 3) in vec4 inPositionSize; // xyz = center, w = radius
+
+out vec4 vColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 cameraWorldPos;
+uniform vec3 lightPosition;
+uniform float pixelScale; // screenHeight / (2 * tan(fov / 2))
+
+// Per-asteroid pseudo random value; the size is constant per asteroid
+float asteroidSeed(float size) {
+    return fract(sin(size * 12.9898 * 1000.0) * 43758.5453);
+}
+
+vec3 asteroidAlbedo(float seed) {
+    return mix(vec3(0.35, 0.32, 0.30), vec3(0.55, 0.47, 0.40), seed);
+}
+
+void main()
+{
+    vec3 center = inPositionSize.xyz;
+    float size = inPositionSize.w;
+
+    gl_Position = projection * view * vec4(center, 1.0);
+
+    float dist = max(length(cameraWorldPos - center), 1e-4);
+    float diameter = 2.0 * size * pixelScale / dist;
+    gl_PointSize = max(diameter, 1.0);
+
+    // Light the whole point by its phase angle: fully lit when the light is
+    // behind the camera, dark when the asteroid is back-lit.
+    vec3 toCamera = (cameraWorldPos - center) / dist;
+    vec3 toLight = normalize(lightPosition - center);
+    float phase = 0.5 + 0.5 * dot(toCamera, toLight);
+
+    // Sub-pixel asteroids fade out instead of flickering
+    float coverage = clamp(diameter, 0.0, 1.0);
+    vColor = vec4(asteroidAlbedo(asteroidSeed(size)) * (0.1 + 0.9 * phase), coverage);
+}
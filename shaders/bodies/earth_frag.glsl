@@ -166,136 +166,6 @@ vec3 get_surface_normal(vec3 pos)
     return n;
 }
 
-//
-// Description : Array and textureless GLSL 2D/3D/4D simplex 
-//               noise functions.
-//      Author : Ian McEwan, Ashima Arts.
-//  Maintainer : stegu
-//     Lastmod : 20110822 (ijm)
-//     License : Copyright (C) 2011 Ashima Arts. All rights reserved.
-//               Distributed under the MIT License. See LICENSE file.
-//               https://github.com/ashima/webgl-noise
-//               https://github.com/stegu/webgl-noise
-// 
-
-// vec4 mod289(vec4 x) {
-//   return x - floor(x * (1.0 / 289.0)) * 289.0; }
-
-float mod289(float x) {
-  return x - floor(x * (1.0 / 289.0)) * 289.0; }
-
-// vec4 permute(vec4 x) {
-//      return mod289(((x*34.0)+10.0)*x);
-// }
-
-float permute(float x) {
-     return mod289(((x*34.0)+10.0)*x);
-}
-
-// vec4 taylorInvSqrt(vec4 r)
-// {
-//   return 1.79284291400159 - 0.85373472095314 * r;
-// }
-
-float taylorInvSqrt(float r)
-{
-  return 1.79284291400159 - 0.85373472095314 * r;
-}
-
-vec4 grad4(float j, vec4 ip)
-{
-    const vec4 ones = vec4(1.0, 1.0, 1.0, -1.0);
-    vec4 p,s;
-
-    p.xyz = floor( fract (vec3(j) * ip.xyz) * 7.0) * ip.z - 1.0;
-    p.w = 1.5 - dot(abs(p.xyz), ones.xyz);
-    s = vec4(lessThan(p, vec4(0.0)));
-    p.xyz = p.xyz + (s.xyz*2.0 - 1.0) * s.www; 
-
-    return p;
-}
-						
-// (sqrt(5) - 1)/4 = F4, used once below
-#define F4 0.309016994374947451
-
-float snoise(vec4 v)
-{
-    const vec4  C = vec4( 0.138196601125011,  // (5 - sqrt(5))/20  G4
-                        0.276393202250021,  // 2 * G4
-                        0.414589803375032,  // 3 * G4
-                        -0.447213595499958); // -1 + 4 * G4
-
-    // First corner
-    vec4 i  = floor(v + dot(v, vec4(F4)) );
-    vec4 x0 = v -   i + dot(i, C.xxxx);
-
-    // Other corners
-
-    // Rank sorting originally contributed by Bill Licea-Kane, AMD (formerly ATI)
-    vec4 i0;
-    vec3 isX = step( x0.yzw, x0.xxx );
-    vec3 isYZ = step( x0.zww, x0.yyz );
-    //  i0.x = dot( isX, vec3( 1.0 ) );
-    i0.x = isX.x + isX.y + isX.z;
-    i0.yzw = 1.0 - isX;
-    //  i0.y += dot( isYZ.xy, vec2( 1.0 ) );
-    i0.y += isYZ.x + isYZ.y;
-    i0.zw += 1.0 - isYZ.xy;
-    i0.z += isYZ.z;
-    i0.w += 1.0 - isYZ.z;
-
-    // i0 now contains the unique values 0,1,2,3 in each channel
-    vec4 i3 = clamp( i0, 0.0, 1.0 );
-    vec4 i2 = clamp( i0-1.0, 0.0, 1.0 );
-    vec4 i1 = clamp( i0-2.0, 0.0, 1.0 );
-
-    //  x0 = x0 - 0.0 + 0.0 * C.xxxx
-    //  x1 = x0 - i1  + 1.0 * C.xxxx
-    //  x2 = x0 - i2  + 2.0 * C.xxxx
-    //  x3 = x0 - i3  + 3.0 * C.xxxx
-    //  x4 = x0 - 1.0 + 4.0 * C.xxxx
-    vec4 x1 = x0 - i1 + C.xxxx;
-    vec4 x2 = x0 - i2 + C.yyyy;
-    vec4 x3 = x0 - i3 + C.zzzz;
-    vec4 x4 = x0 + C.wwww;
-
-    // Permutations
-    i = mod289(i); 
-    float j0 = permute( permute( permute( permute(i.w) + i.z) + i.y) + i.x);
-    vec4 j1 = permute( permute( permute( permute (
-                i.w + vec4(i1.w, i2.w, i3.w, 1.0 ))
-            + i.z + vec4(i1.z, i2.z, i3.z, 1.0 ))
-            + i.y + vec4(i1.y, i2.y, i3.y, 1.0 ))
-            + i.x + vec4(i1.x, i2.x, i3.x, 1.0 ));
-
-    // Gradients: 7x7x6 points over a cube, mapped onto a 4-cross polytope
-    // 7*7*6 = 294, which is close to the ring size 17*17 = 289.
-    vec4 ip = vec4(1.0/294.0, 1.0/49.0, 1.0/7.0, 0.0) ;
-
-    vec4 p0 = grad4(j0,   ip);
-    vec4 p1 = grad4(j1.x, ip);
-    vec4 p2 = grad4(j1.y, ip);
-    vec4 p3 = grad4(j1.z, ip);
-    vec4 p4 = grad4(j1.w, ip);
-
-    // Normalise gradients
-    vec4 norm = taylorInvSqrt(vec4(dot(p0,p0), dot(p1,p1), dot(p2, p2), dot(p3,p3)));
-    p0 *= norm.x;
-    p1 *= norm.y;
-    p2 *= norm.z;
-    p3 *= norm.w;
-    p4 *= taylorInvSqrt(dot(p4,p4));
-
-    // Mix contributions from the five corners
-    vec3 m0 = max(0.57 - vec3(dot(x0,x0), dot(x1,x1), dot(x2,x2)), 0.0);
-    vec2 m1 = max(0.57 - vec2(dot(x3,x3), dot(x4,x4)            ), 0.0);
-    m0 = m0 * m0;
-    m1 = m1 * m1;
-    return 60.1 * ( dot(m0*m0, vec3( dot( p0, x0 ), dot( p1, x1 ), dot( p2, x2 )))
-                + dot(m1*m1, vec2( dot( p3, x3 ), dot( p4, x4 ) ) ) ) ;
-
-}
-
 in vec3 fragPosition;
 in vec3 spherePosition;
 in float height;
@@ -312,44 +182,52 @@ uniform vec3 planet_center = vec3(0.0, 0.0, 0.0);
 uniform float ocean_scale = 10.0;
 uniform float ocean_speed = 0.3;
 
-// Parameters
-uniform int OCTAVES_water = 5;
-uniform float LACUNARITY_water = 2.0;
-uniform float PERSISTENCE_water = 0.45;
+// Tileable ocean slope maps baked by ocean_bake_frag.glsl (rg = height
+// slope along the texture axes, in noise units), one layer per wave set.
+uniform sampler2DArray oceanSlopes;
+uniform float ocean_tile_size = 8.0;
 
-// Fractal 4D Simplex Noise
-float fractalNoise(vec4 p) {
-    float value = 0.0;
-    float amplitude = 1.0;
-    float frequency = 1.0;
-    float maxVal = 0.0;
+uniform float ocean_normal_gradient_multiplier = 0.01;
 
-    for (int i = 0; i < OCTAVES_water; i++) {
-        value += snoise(p * frequency) * amplitude;
-        maxVal += amplitude;
-        amplitude *= PERSISTENCE_water;
-        frequency *= LACUNARITY_water;
+// Height slope of one scrolling wave layer, projected triplanar on the sphere.
+// dpdx/dpdy are the screen derivatives of pos, taken in uniform control flow.
+vec3 oceanLayerGradient(vec3 pos, vec3 dpdx, vec3 dpdy, vec3 weights,
+                        float layer, vec2 offset) {
+    float s = ocean_scale / ocean_tile_size;
+    vec3 p = pos * s;
+    dpdx *= s;
+    dpdy *= s;
+    vec3 grad = vec3(0.0);
+    if (weights.x > 0.0) {
+        vec2 d = textureGrad(oceanSlopes, vec3(p.yz + offset, layer), dpdx.yz, dpdy.yz).rg;
+        grad += weights.x * vec3(0.0, d.x, d.y);
     }
-    return value / maxVal;
+    if (weights.y > 0.0) {
+        vec2 d = textureGrad(oceanSlopes, vec3(p.zx + offset, layer), dpdx.zx, dpdy.zx).rg;
+        grad += weights.y * vec3(d.y, 0.0, d.x);
+    }
+    if (weights.z > 0.0) {
+        vec2 d = textureGrad(oceanSlopes, vec3(p.xy + offset, layer), dpdx.xy, dpdy.xy).rg;
+        grad += weights.z * vec3(d.x, d.y, 0.0);
+    }
+    return grad;
 }
 
-
-uniform float ocean_normal_gradient_multiplier = 0.01;
-
 // Computes a procedural ocean normal for a spherical planet
-vec3 getOceanNormal(vec3 pos, float time) {
-    float eps = 0.001; // small step for finite differences
-    float delta = 0.001;
-    
-    float h = fractalNoise(vec4(pos * ocean_scale, time * ocean_speed));
+vec3 getOceanNormal(vec3 pos, vec3 dpdx, vec3 dpdy, float time) {
+    // triplanar weights, sharpened so most fragments only need one plane
+    vec3 weights = pow(abs(pos), vec3(4.0));
+    weights = max(weights / (weights.x + weights.y + weights.z) - 0.05, 0.0);
+    weights /= weights.x + weights.y + weights.z;
 
-    float hx = fractalNoise(vec4((pos + vec3(1.0, 0.0, 0.0) * delta) * ocean_scale, time * ocean_speed));
-    float hy = fractalNoise(vec4((pos + vec3(0.0, 1.0, 0.0) * delta) * ocean_scale, time * ocean_speed));
-    float hz = fractalNoise(vec4((pos + vec3(0.0, 0.0, 1.0) * delta) * ocean_scale, time * ocean_speed));
+    // two wave sets drifting in different directions (in tiles)
+    float drift = time * ocean_speed / ocean_tile_size;
+    vec3 grad = oceanLayerGradient(pos, dpdx, dpdy, weights, 0.0, vec2(1.0, 0.3) * drift)
+              + oceanLayerGradient(pos, dpdx, dpdy, weights, 1.0, vec2(-0.4, -1.0) * drift);
+
+    // chain rule for the ocean_scale scaling of pos
+    grad *= 0.5 * ocean_scale;
 
-    // Compute gradient in tangent plane
-    vec3 grad = vec3(hx - h, hy - h, hz - h) / eps;
-    
     // Normal points opposite to gradient, then normalize
     vec3 n = normalize(pos - grad * ocean_normal_gradient_multiplier);
     return n;
@@ -488,6 +366,10 @@ void main()
     float shadowMultiplier = 1.0;
     // shadowMultiplier = 1.0 - shadow_calculation(fragPosition);
 
+    // needed for texture filtering in the ocean branch below
+    vec3 sphereDx = dFdx(spherePosition);
+    vec3 sphereDy = dFdy(spherePosition);
+
     if (height < ocean_level) {
         float ocean_depth = ocean_level - height;
         vec3 waterColor = vec3(0.0, 0.0, 1.0);
@@ -506,7 +388,7 @@ void main()
             waterColor = mix(col2, col3, t);
         }
 
-        vec3 normal = getOceanNormal(spherePosition, time);
+        vec3 normal = getOceanNormal(spherePosition, sphereDx, sphereDy, time);
         vec3 lightDir = normalize(lightPosition - fragPosition);
 
         // Phong reflection model
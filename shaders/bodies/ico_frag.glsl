@@ -10,15 +10,14 @@ layout(std140) uniform Material // Must match the GPUMaterial defined in src/mes
 
 in vec3 fragPosition;
 in vec3 spherePosition;
+flat in vec4 fragPosRadius; // xyz = body center, w = radius
+flat in vec4 fragParams;    // rgb = color, a = test
 
 layout(location = 0) out vec4 fragColor;
 
 
 vec3 lightPos = vec3(10.0, 0.0, 0.0);
-uniform vec3 color = vec3(0.3, 0.3, 1.0);
 uniform float time;
-uniform vec3 planet_center;
-uniform float radius;
 
 
 // Eclipse "ray tracing"
@@ -40,6 +39,8 @@ vec3 projectPointOntoPlane(vec3 P0, vec3 P1, vec3 N) {
 }
 
 float eclipse_factor(vec3 fragPos, vec4 sunPosRad) {
+    vec3 planet_center = fragPosRadius.xyz;
+
     vec3 sunPos = sunPosRad.xyz;
     float sunRad = sunPosRad.w;
 
@@ -95,5 +96,6 @@ void main()
 
     float ambient = 0.1;
 
+    vec3 color = fragParams.rgb;
     fragColor = vec4(color * (diffuse * eclipseLightFactor + ambient), 1.0);
 }
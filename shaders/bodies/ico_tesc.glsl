@@ -2,21 +2,25 @@
 layout(vertices = 3) out;
 
 in vec3 vsPosition[];
+in vec4 vsPosRadius[];
+in vec4 vsParams[];
 out vec3 tcsPosition[];
+out vec4 tcsPosRadius[];
+out vec4 tcsParams[];
 
 uniform vec3 cameraWorldPos;
 float tessMin = 1.0;
 float tessMax = 64.0;
-uniform float radius = 1.0;
 uniform float targetPixelSize = 5.0; // desired triangle size in pixels
 uniform float screenHeight = 1024.0;
 uniform float fov = 1.3962; // vertical FOV in radians (~80 deg)
 uniform int tessellate = 1; // whether to apply tessellation
 
-float computeTessLevel(vec3 p0, vec3 p1, vec3 p2)
+float computeTessLevel(vec3 p0, vec3 p1, vec3 p2, vec4 posRadius)
 {
-    vec3 center = (p0 + p1 + p2) / 3.0;
-    float dist = length(cameraWorldPos - center);
+    float radius = posRadius.w;
+    vec3 center = posRadius.xyz + normalize(p0 + p1 + p2) * radius;
+    float dist = max(length(cameraWorldPos - center), 1e-4);
 
     float projectedSize = (radius / dist) * (screenHeight / (2.0 * tan(fov / 2.0)));
 
@@ -27,6 +31,8 @@ float computeTessLevel(vec3 p0, vec3 p1, vec3 p2)
 void main()
 {
     tcsPosition[gl_InvocationID] = vsPosition[gl_InvocationID];
+    tcsPosRadius[gl_InvocationID] = vsPosRadius[gl_InvocationID];
+    tcsParams[gl_InvocationID] = vsParams[gl_InvocationID];
 
     if (gl_InvocationID == 0)
     {
@@ -37,7 +43,7 @@ void main()
             gl_TessLevelInner[0] = 1.0;
         }
         else{
-            float t = computeTessLevel(vsPosition[0], vsPosition[1], vsPosition[2]);
+            float t = computeTessLevel(vsPosition[0], vsPosition[1], vsPosition[2], vsPosRadius[0]);
 
             gl_TessLevelOuter[0] = t;
             gl_TessLevelOuter[1] = t;
@@ -2,14 +2,18 @@
 layout(triangles, equal_spacing, ccw) in;
 
 in vec3 tcsPosition[];
+in vec4 tcsPosRadius[];
+in vec4 tcsParams[];
 out vec3 fragPosition;
 out vec3 spherePosition;
+flat out vec4 fragPosRadius;
+flat out vec4 fragParams;
 
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform float radius = 1.0;
+uniform int instanced = 0;
 
 void main()
 {
@@ -21,9 +25,16 @@ void main()
                gl_TessCoord.y * p1 +
                gl_TessCoord.z * p2;
 
+    vec4 posRadius = tcsPosRadius[0];
     spherePosition = normalize(pos);
-    pos = normalize(pos) * radius;
+    pos = spherePosition * posRadius.w;
 
-    gl_Position = projection * view * model * vec4(pos, 1.0);
-    fragPosition = (model * vec4(pos, 1.0)).xyz;
+    // batched bodies have no model matrix, their center comes per instance
+    vec4 worldPos = instanced == 1 ? vec4(posRadius.xyz + pos, 1.0)
+                                   : model * vec4(pos, 1.0);
+
+    gl_Position = projection * view * worldPos;
+    fragPosition = worldPos.xyz;
+    fragPosRadius = posRadius;
+    fragParams = tcsParams[0];
 }
@@ -3,8 +3,30 @@
 layout(location = 0) in vec3 position;
 
 out vec3 vsPosition;
+out vec4 vsPosRadius; // xyz = body center (world space), w = radius
+out vec4 vsParams;    // rgb = color, a = test
+
+// Per-instance data for batched bodies, two texels per instance:
+// [2 * i + 0] = (center, radius), [2 * i + 1] = (color, test), after
+// instanceDataOffset texels
+uniform int instanced = 0;
+uniform samplerBuffer instanceData;
+uniform int instanceDataOffset = 0;
+
+// Used when drawing a single body
+uniform vec3 planet_center = vec3(0.0);
+uniform float radius = 1.0;
+uniform vec3 color = vec3(0.3, 0.3, 1.0);
+uniform float test = 0.0;
 
 void main()
 {
     vsPosition = position;
+    if (instanced == 1) {
+        vsPosRadius = texelFetch(instanceData, instanceDataOffset + 2 * gl_InstanceID);
+        vsParams = texelFetch(instanceData, instanceDataOffset + 2 * gl_InstanceID + 1);
+    } else {
+        vsPosRadius = vec4(planet_center, radius);
+        vsParams = vec4(color, test);
+    }
 }
@@ -0,0 +1,12 @@
+#version 410 core
+
+// Fullscreen triangle generated from gl_VertexID, draw with 3 vertices and an
+// empty VAO bound.
+out vec2 uv; // [0, 1] over the viewport
+
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
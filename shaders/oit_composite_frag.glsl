@@ -0,0 +1,21 @@
+#version 410 core
+
+// Resolves the weighted blended OIT targets, see WeightedOIT.
+// Blended over the scene with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA.
+uniform sampler2D accumTexture;
+uniform sampler2D revealTexture;
+
+out vec4 fragColor;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(revealTexture, texel, 0).r;
+    if (revealage >= 1.0) {
+        discard; // nothing transparent here
+    }
+
+    vec4 accum = texelFetch(accumTexture, texel, 0);
+    vec3 averageColor = accum.rgb / max(accum.a, 1e-5);
+    fragColor = vec4(averageColor, 1.0 - revealage);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+#include <framework/shader.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <array>
+#include <cmath>
+
+// A procedural cube map texture that is re-baked at a fixed rate instead of
+// being evaluated per pixel every frame.
+//
+// Time is split into slices of 1 / update_rate seconds. While the frame time
+// is inside slice k, slices k and k + 1 are complete and can be blended by
+// get_blend(); slice k + 2 is baked in the background, a few faces per frame,
+// so the cost of one full bake is spread over the whole slice.
+//
+// The bake shader is drawn as a fullscreen triangle (shaders/fullscreen_vert.glsl)
+// once per face and receives the uniforms `face` (0..5, in
+// GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order) and `bake_time`.
+class AnimatedCubemap {
+   public:
+    static constexpr int NUM_FACES = 6;
+
+    AnimatedCubemap(int face_resolution, GLenum internal_format)
+        : resolution(face_resolution) {
+        glGenTextures((GLsizei)textures.size(), textures.data());
+        for (GLuint texture : textures) {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+            for (int face = 0; face < NUM_FACES; face++) {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)face, 0,
+                             (GLint)internal_format, resolution, resolution, 0,
+                             GL_RED, GL_FLOAT, nullptr);
+            }
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        // Filter across face edges, otherwise the seams show up on the sphere
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        glGenFramebuffers(1, &fbo);
+        // core profile needs a bound VAO even if no attributes are read
+        glGenVertexArrays(1, &empty_vao);
+    }
+
+    AnimatedCubemap(const AnimatedCubemap&) = delete;
+    AnimatedCubemap& operator=(const AnimatedCubemap&) = delete;
+
+    ~AnimatedCubemap() {
+        glDeleteVertexArrays(1, &empty_vao);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures((GLsizei)textures.size(), textures.data());
+    }
+
+    // Forces both visible slices to be re-baked on the next update, e.g. after
+    // the bake parameters changed.
+    void invalidate() { valid = false; }
+
+    // Bakes whatever faces are due at `time`. `bake_shader` must be bound with
+    // all of its other uniforms set. Leaves the framebuffer and viewport
+    // changed, reset the OpenGL state afterwards.
+    void update(float time, float update_rate, const Shader& bake_shader) {
+        faces_baked = 0;
+        slice_duration = 1.0f / glm::max(update_rate, 0.01f);
+        long slice = (long)std::floor(time / slice_duration);
+
+        if (!valid || slice < current_slice || slice > current_slice + 1) {
+            // First frame, parameter change or a jump in time: nothing baked
+            // so far is usable, bake both visible slices right away.
+            current_slice = slice;
+            bake_all_faces(bake_shader, slot_prev, current_slice);
+            bake_all_faces(bake_shader, slot_next, current_slice + 1);
+            faces_done = 0;
+            valid = true;
+        } else if (slice == current_slice + 1) {
+            // Entered the next slice; finish the pending one and rotate
+            bake_faces(bake_shader, slot_pending, current_slice + 2, NUM_FACES);
+            int old_prev = slot_prev;
+            slot_prev = slot_next;
+            slot_next = slot_pending;
+            slot_pending = old_prev;
+            current_slice = slice;
+            faces_done = 0;
+        }
+
+        // Spread the pending slice evenly over the current one, one face at
+        // the start so the last face isn't left for the rotation frame.
+        int faces_due = glm::min(NUM_FACES, 1 + (int)(get_blend(time) * NUM_FACES));
+        bake_faces(bake_shader, slot_pending, current_slice + 2, faces_due);
+    }
+
+    // Position of `time` between the two visible slices, in [0, 1)
+    float get_blend(float time) const {
+        float blend = time / slice_duration - (float)current_slice;
+        return glm::clamp(blend, 0.0f, 1.0f);
+    }
+
+    void bind_for_reading(GLenum texture_unit_prev, GLenum texture_unit_next) const {
+        glActiveTexture(texture_unit_prev);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textures[(size_t)slot_prev]);
+        glActiveTexture(texture_unit_next);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textures[(size_t)slot_next]);
+    }
+
+    int get_resolution() const { return resolution; }
+    // Faces rendered by the last update() call
+    int get_faces_baked() const { return faces_baked; }
+
+   private:
+    void bake_all_faces(const Shader& bake_shader, int slot, long slice) {
+        faces_done = 0;
+        bake_faces(bake_shader, slot, slice, NUM_FACES);
+    }
+
+    // Bakes faces [faces_done, last_face) of `slot` at the time of `slice`
+    void bake_faces(const Shader& bake_shader, int slot, long slice, int last_face) {
+        if (faces_done >= last_face) return;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, resolution, resolution);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(empty_vao);
+        glUniform1f(bake_shader.getUniformLocation("bake_time"),
+                    (float)slice * slice_duration);
+
+        for (; faces_done < last_face; faces_done++) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)faces_done,
+                                   textures[(size_t)slot], 0);
+            glUniform1i(bake_shader.getUniformLocation("face"), faces_done);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            faces_baked++;
+        }
+
+        glBindVertexArray(0);
+    }
+
+    int resolution;
+    std::array<GLuint, 3> textures{};
+    GLuint fbo = 0;
+    GLuint empty_vao = 0;
+
+    int slot_prev = 0;     // slice current_slice
+    int slot_next = 1;     // slice current_slice + 1
+    int slot_pending = 2;  // slice current_slice + 2, partially baked
+    int faces_done = 0;    // faces of slot_pending baked so far
+
+    bool valid = false;
+    long current_slice = 0;
+    float slice_duration = 1.0f;
+    int faces_baked = 0;
+};
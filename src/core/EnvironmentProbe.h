@@ -0,0 +1,128 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+
+// Low resolution cube map of the scene around a moving point (the
+// battlecruiser), sampled by reflective materials instead of the static
+// skybox.
+//
+// Rendering the six faces every frame would cost six scene renders, so faces
+// are refreshed round-robin, faces_per_frame at a time: with one per frame
+// each face is at most six frames old and a frame pays for one low
+// resolution face. The first update renders all six faces so the map never
+// shows uninitialized ones.
+class EnvironmentProbe {
+   public:
+    static constexpr int NUM_FACES = 6;
+
+    explicit EnvironmentProbe(int face_resolution) : resolution(face_resolution) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        for (int face = 0; face < NUM_FACES; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)face, 0, GL_RGBA8,
+                         resolution, resolution, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        // one depth buffer is enough, faces are rendered one after the other
+        glGenRenderbuffers(1, &depth_buffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution,
+                              resolution);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  GL_RENDERBUFFER, depth_buffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    EnvironmentProbe(const EnvironmentProbe&) = delete;
+    EnvironmentProbe& operator=(const EnvironmentProbe&) = delete;
+
+    ~EnvironmentProbe() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &depth_buffer);
+        glDeleteTextures(1, &texture);
+    }
+
+    // Renders the faces due this frame as seen from `position`, calling
+    // draw_face(view, projection) for each with its framebuffer bound and
+    // cleared. draw_face may bind other framebuffers as long as it calls
+    // bind_for_writing() again before drawing into the probe. Leaves the
+    // framebuffer and viewport changed, reset the OpenGL state afterwards.
+    template <typename F>
+    void update(const glm::vec3& position, int faces_per_frame, F&& draw_face) {
+        faces_rendered = 0;
+        int faces = initialized ? std::clamp(faces_per_frame, 0, NUM_FACES) : NUM_FACES;
+        initialized = true;
+
+        const glm::mat4 projection =
+            glm::perspective(glm::radians(90.0f), 1.0f, near_plane, far_plane);
+        for (int i = 0; i < faces; i++) {
+            current_face = next_face;
+            next_face = (next_face + 1) % NUM_FACES;
+
+            bind_for_writing();
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            draw_face(get_face_view(current_face, position), projection);
+            faces_rendered++;
+        }
+    }
+
+    // Binds the face being rendered and sets the viewport to it
+    void bind_for_writing() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)current_face,
+                               texture, 0);
+        glViewport(0, 0, resolution, resolution);
+    }
+
+    // View matrix of a face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order
+    static glm::mat4 get_face_view(int face, const glm::vec3& position) {
+        static const glm::vec3 directions[NUM_FACES] = {
+            {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+            {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+        // cube map faces are addressed with t pointing down
+        static const glm::vec3 ups[NUM_FACES] = {
+            {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f},
+            {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}};
+        return glm::lookAt(position, position + directions[face], ups[face]);
+    }
+
+    GLuint get_texture() const { return texture; }
+    int get_resolution() const { return resolution; }
+    // Faces rendered by the last update() call
+    int get_faces_rendered() const { return faces_rendered; }
+
+   private:
+    int resolution;
+    GLuint texture = 0;
+    GLuint depth_buffer = 0;
+    GLuint fbo = 0;
+
+    float near_plane = 0.1f;
+    float far_plane = 1000.0f;
+
+    bool initialized = false;
+    int current_face = 0;
+    int next_face = 0;
+    int faces_rendered = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <array>
+
+// View frustum as six world-space planes (xyz = inward normal, w = distance),
+// extracted from a combined projection * view matrix (Gribb & Hartmann).
+class Frustum {
+   public:
+    // (prefixed because windows.h defines NEAR/FAR)
+    enum Plane { PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+    Frustum() = default;
+
+    explicit Frustum(const glm::mat4& view_projection) {
+        // glm is column-major, so row i of the matrix is (m[0][i], m[1][i], ...)
+        const glm::mat4& m = view_projection;
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        planes[PLANE_LEFT] = row3 + row0;
+        planes[PLANE_RIGHT] = row3 - row0;
+        planes[PLANE_BOTTOM] = row3 + row1;
+        planes[PLANE_TOP] = row3 - row1;
+        planes[PLANE_NEAR] = row3 + row2;
+        planes[PLANE_FAR] = row3 - row2;
+
+        for (glm::vec4& plane : planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    // Conservative test: true if any part of the sphere may be inside.
+    bool intersects_sphere(const glm::vec3& center, float radius) const {
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const glm::vec4& get_plane(Plane plane) const { return planes[plane]; }
+
+   private:
+    std::array<glm::vec4, PLANE_COUNT> planes{};
+};
+
+// Approximate height in pixels of a sphere's projection on screen.
+inline float projected_sphere_size(const glm::vec3& center, float radius,
+                                   const glm::vec3& camera_position,
+                                   float fov_radians, float screen_height) {
+    float dist = glm::length(center - camera_position);
+    if (dist <= radius) {
+        return screen_height;  // camera is inside the sphere
+    }
+    return 2.0f * (radius / dist) * (screen_height / (2.0f * glm::tan(fov_radians / 2.0f)));
+}
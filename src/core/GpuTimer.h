@@ -0,0 +1,61 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+DISABLE_WARNINGS_POP()
+
+#include <array>
+
+// Measures GPU time of the commands between begin() and end() with a pair
+// of GL_TIMESTAMP queries. Unlike GL_TIME_ELAPSED these may nest, so a frame
+// timer can contain per-pass timers. Results are read a few frames later
+// from a small ring of queries, so reading them doesn't stall the pipeline.
+class GpuTimer {
+   public:
+    static constexpr int LATENCY = 3;
+
+    GpuTimer() {
+        glGenQueries(LATENCY, start_queries.data());
+        glGenQueries(LATENCY, end_queries.data());
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    ~GpuTimer() {
+        glDeleteQueries(LATENCY, end_queries.data());
+        glDeleteQueries(LATENCY, start_queries.data());
+    }
+
+    void begin() {
+        current = (current + 1) % LATENCY;
+        if (pending[current]) {
+            // issued LATENCY frames ago, normally long finished
+            GLuint64 start_ns = 0;
+            GLuint64 end_ns = 0;
+            glGetQueryObjectui64v(start_queries[current], GL_QUERY_RESULT, &start_ns);
+            glGetQueryObjectui64v(end_queries[current], GL_QUERY_RESULT, &end_ns);
+            last_ms = (float)(end_ns - start_ns) * 1e-6f;
+            has_result = true;
+        }
+        glQueryCounter(start_queries[current], GL_TIMESTAMP);
+    }
+
+    void end() {
+        glQueryCounter(end_queries[current], GL_TIMESTAMP);
+        pending[current] = true;
+    }
+
+    // Most recent finished measurement
+    float get_ms() const { return last_ms; }
+    bool has_measurement() const { return has_result; }
+
+   private:
+    std::array<GLuint, LATENCY> start_queries{};
+    std::array<GLuint, LATENCY> end_queries{};
+    std::array<bool, LATENCY> pending{};
+    size_t current = 0;
+    float last_ms = 0.0f;
+    bool has_result = false;
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+// S3TC is an extension (EXT_texture_compression_s3tc) rather than core 4.1,
+// so the generated loader doesn't define its enums. Every desktop driver
+// exposes it; is_compressed_format_supported checks anyway.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Block-compressed texture with its whole mip chain, as written by
+// tools/texture_converter.cpp and uploaded as is with glCompressedTexImage2D.
+//
+// The file is KTX 1.1 (Khronos), restricted to what the converter writes:
+// compressed 2D textures or cube maps, no array layers, native endianness.
+// Key/value data is skipped on read.
+struct KtxFile {
+    GLenum internal_format = 0;       // e.g. GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    GLenum base_internal_format = 0;  // GL_RGB or GL_RGBA
+    int width = 0;
+    int height = 0;
+    int faces = 1;  // 6 for a cube map, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order
+    // levels[level] holds the faces of that level back to back, the same
+    // number of bytes each
+    std::vector<std::vector<uint8_t>> levels;
+
+    size_t get_face_size(int level) const { return levels[size_t(level)].size() / size_t(faces); }
+    const uint8_t* get_face_data(int level, int face) const {
+        return levels[size_t(level)].data() + size_t(face) * get_face_size(level);
+    }
+};
+
+namespace ktx_detail {
+
+constexpr uint8_t IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                    0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr uint32_t ENDIANNESS = 0x04030201;
+
+struct Header {
+    uint32_t endianness;
+    uint32_t gl_type;
+    uint32_t gl_type_size;
+    uint32_t gl_format;
+    uint32_t gl_internal_format;
+    uint32_t gl_base_internal_format;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t number_of_array_elements;
+    uint32_t number_of_faces;
+    uint32_t number_of_mipmap_levels;
+    uint32_t bytes_of_key_value_data;
+};
+
+constexpr size_t padding(size_t size) { return (4 - size % 4) % 4; }
+
+}  // namespace ktx_detail
+
+// Bytes of one face of a mip level of a 4x4 block format (BC1 has 8 bytes
+// per block, BC3 16)
+inline size_t compressed_level_size(GLenum internal_format, int width, int height) {
+    const size_t block_bytes = internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) * block_bytes;
+}
+
+inline bool is_supported_ktx_format(GLenum internal_format) {
+    return internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ||
+           internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+// Reports problems on std::cerr and returns nothing. Everything the upload
+// relies on is checked against the header (format, dimensions, level count
+// and the size of every level), so a truncated or foreign file is rejected
+// before anything large is allocated.
+inline std::optional<KtxFile> read_ktx(const std::filesystem::path& path) {
+    using namespace ktx_detail;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open KTX file " << path << std::endl;
+        return std::nullopt;
+    }
+
+    uint8_t identifier[sizeof(IDENTIFIER)];
+    Header header;
+    file.read(reinterpret_cast<char*>(identifier), sizeof(identifier));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+        std::cerr << path << " is not a KTX 1.1 file" << std::endl;
+        return std::nullopt;
+    }
+    if (header.endianness != ENDIANNESS || header.gl_type != 0 ||
+        header.pixel_depth > 1 || header.number_of_array_elements != 0 ||
+        (header.number_of_faces != 1 && header.number_of_faces != 6)) {
+        std::cerr << path
+                  << " isn't a native-endian compressed 2D texture or cube map"
+                  << std::endl;
+        return std::nullopt;
+    }
+    constexpr uint32_t MAX_SIZE = 16384;
+    const uint32_t max_levels =
+        header.pixel_width > 0 && header.pixel_height > 0
+            ? std::bit_width(std::max(header.pixel_width, header.pixel_height))
+            : 0;
+    if (!is_supported_ktx_format(header.gl_internal_format) ||
+        header.pixel_width == 0 || header.pixel_height == 0 ||
+        header.pixel_width > MAX_SIZE || header.pixel_height > MAX_SIZE ||
+        header.number_of_mipmap_levels > max_levels) {
+        std::cerr << path << " isn't a BC1/BC3 texture of at most " << MAX_SIZE
+                  << " pixels with a valid mip count" << std::endl;
+        return std::nullopt;
+    }
+
+    KtxFile ktx;
+    ktx.internal_format = header.gl_internal_format;
+    ktx.base_internal_format =
+        ktx.internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? GL_RGB : GL_RGBA;
+    ktx.width = int(header.pixel_width);
+    ktx.height = int(header.pixel_height);
+    ktx.faces = int(header.number_of_faces);
+    const size_t num_faces = header.number_of_faces;
+    // 0 asks the loader to generate mipmaps, which compressed formats can't
+    const uint32_t num_levels = std::max(header.number_of_mipmap_levels, 1u);
+    auto get_face_size = [&](uint32_t level) {
+        return compressed_level_size(ktx.internal_format, std::max(ktx.width >> level, 1),
+                                     std::max(ktx.height >> level, 1));
+    };
+
+    // the whole file must be there before the levels are allocated
+    uintmax_t expected_size = sizeof(IDENTIFIER) + sizeof(Header) + header.bytes_of_key_value_data;
+    for (uint32_t level = 0; level < num_levels; level++) {
+        expected_size += sizeof(uint32_t) + num_faces * (get_face_size(level) + padding(get_face_size(level)));
+    }
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) < expected_size || error) {
+        std::cerr << path << " is shorter than its header says" << std::endl;
+        return std::nullopt;
+    }
+    file.seekg(header.bytes_of_key_value_data, std::ios::cur);
+
+    for (uint32_t level = 0; level < num_levels; level++) {
+        // for a cube map this is the size of one face
+        uint32_t image_size = 0;
+        file.read(reinterpret_cast<char*>(&image_size), sizeof(image_size));
+        const size_t face_size = get_face_size(level);
+        if (!file || image_size != (num_faces == 6 ? face_size : face_size * num_faces)) {
+            std::cerr << path << ": mip level " << level << " has " << image_size
+                      << " bytes, expected " << face_size * num_faces << std::endl;
+            return std::nullopt;
+        }
+
+        std::vector<uint8_t>& data = ktx.levels.emplace_back(face_size * num_faces);
+        for (size_t face = 0; face < num_faces; face++) {
+            file.read(reinterpret_cast<char*>(data.data() + face * face_size),
+                      std::streamsize(face_size));
+            file.seekg(std::streamoff(padding(face_size)), std::ios::cur);
+        }
+        if (!file) {
+            std::cerr << path << " ends in mip level " << level << std::endl;
+            return std::nullopt;
+        }
+    }
+    return ktx;
+}
+
+inline bool write_ktx(const std::filesystem::path& path, const KtxFile& ktx) {
+    using namespace ktx_detail;
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to create " << path << std::endl;
+        return false;
+    }
+
+    const Header header{ENDIANNESS,
+                        0,  // compressed: no type, format or type size
+                        1,
+                        0,
+                        ktx.internal_format,
+                        ktx.base_internal_format,
+                        uint32_t(ktx.width),
+                        uint32_t(ktx.height),
+                        0,
+                        0,
+                        uint32_t(ktx.faces),
+                        uint32_t(ktx.levels.size()),
+                        0};
+    file.write(reinterpret_cast<const char*>(IDENTIFIER), sizeof(IDENTIFIER));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const char zeros[4] = {};
+    for (int level = 0; level < (int)ktx.levels.size(); level++) {
+        const uint32_t face_size = uint32_t(ktx.get_face_size(level));
+        const uint32_t image_size = ktx.faces == 6 ? face_size : face_size * uint32_t(ktx.faces);
+        file.write(reinterpret_cast<const char*>(&image_size), sizeof(image_size));
+        for (int face = 0; face < ktx.faces; face++) {
+            file.write(reinterpret_cast<const char*>(ktx.get_face_data(level, face)), face_size);
+            file.write(zeros, std::streamsize(padding(face_size)));
+        }
+    }
+    return bool(file);
+}
+
+// Whether the driver lists the format among its compressed texture formats
+inline bool is_compressed_format_supported(GLenum internal_format) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    std::vector<GLint> formats(size_t(std::max(count, 0)));
+    if (count > 0) glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    return std::find(formats.begin(), formats.end(), GLint(internal_format)) != formats.end();
+}
+
+// Uploads every level of the file to the bound GL_TEXTURE_2D, or
+// GL_TEXTURE_CUBE_MAP for six faces, and limits sampling to the levels the
+// file has
+inline void upload_ktx(const KtxFile& ktx) {
+    const GLenum target = ktx.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    for (int level = 0; level < (int)ktx.levels.size(); level++) {
+        const int width = std::max(ktx.width >> level, 1);
+        const int height = std::max(ktx.height >> level, 1);
+        for (int face = 0; face < ktx.faces; face++) {
+            const GLenum face_target =
+                ktx.faces == 6 ? GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face) : target;
+            glCompressedTexImage2D(face_target, level, ktx.internal_format, width,
+                                   height, 0, GLsizei(ktx.get_face_size(level)),
+                                   ktx.get_face_data(level, face));
+        }
+    }
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)ktx.levels.size() - 1);
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+#include <framework/shader.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Occlusion culling with GL_ANY_SAMPLES_PASSED queries on bounding volumes.
+//
+// Testing an object rasterizes its bounding box or sphere, without color or
+// depth writes, against the depth drawn so far, so large occluders (planets)
+// should be drawn first. The answer is read in a later frame, and only once
+// the GPU reports it available, so nothing ever waits on a query; until then
+// the last known answer is used. An object coming out from behind a planet
+// therefore shows up a frame or two late.
+//
+// Objects are identified by a key, normally their address, and keep one
+// query each. An object that wasn't tested in the previous frame (e.g. it
+// was outside the frustum) counts as visible again, and so does one whose
+// bounds contain the camera, as the clipped proxy might not produce samples.
+// Objects not tested for EVICT_AFTER_FRAMES frames give their query back.
+//
+// Tests expect, and leave, the default state of main's reset_opengl_state()
+// (depth test and writes, back-face culling); state isn't queried back as
+// that would stall the pipeline.
+class OcclusionCuller {
+   public:
+    bool enabled = true;
+
+    OcclusionCuller() {
+        shader = ShaderBuilder()
+                     .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/shadow_vert.glsl")
+                     .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT "shaders/shadow_frag.glsl")
+                     .build();
+        build_box();
+        build_sphere();
+    }
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    ~OcclusionCuller() {
+        for (auto& [key, entry] : entries) glDeleteQueries(1, &entry.query);
+        for (Proxy* proxy : {&box, &sphere}) {
+            glDeleteBuffers(1, &proxy->vbo);
+            glDeleteBuffers(1, &proxy->ibo);
+            glDeleteVertexArrays(1, &proxy->vao);
+        }
+    }
+
+    // Call once per frame before any test, with the camera the frame is
+    // drawn with
+    void begin_frame(const glm::mat4& new_view_projection,
+                     const glm::vec3& new_camera_position, float new_near_plane) {
+        frame++;
+        view_projection = new_view_projection;
+        camera_position = new_camera_position;
+        near_plane = new_near_plane;
+        num_tested = 0;
+        num_culled = 0;
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.last_frame + EVICT_AFTER_FRAMES < frame) {
+                glDeleteQueries(1, &it->second.query);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Last answer for the object without testing it again, true if unknown
+    bool is_visible(const void* key) const {
+        if (!enabled) return true;
+        auto it = entries.find(key);
+        return it == entries.end() || it->second.visible || it->second.last_frame + 1 < frame;
+    }
+
+    // Tests a box given in the space of `model`. Binds its own shader and
+    // VAO; rebind yours before drawing. Returns whether to draw the object.
+    bool test_box(const void* key, const glm::mat4& model,
+                  const glm::vec3& box_min, const glm::vec3& box_max) {
+        const glm::vec3 center = 0.5f * (box_min + box_max);
+        const glm::vec3 half_extent = 0.5f * (box_max - box_min);
+        // the proxy cube spans [-1, 1]
+        glm::mat4 proxy_model(glm::vec4(half_extent.x, 0, 0, 0),
+                              glm::vec4(0, half_extent.y, 0, 0),
+                              glm::vec4(0, 0, half_extent.z, 0),
+                              glm::vec4(center, 1.0f));
+        proxy_model = model * proxy_model;
+
+        const glm::vec3 world_center(proxy_model[3]);
+        const float world_radius = glm::length(glm::vec3(proxy_model[0])) +
+                                   glm::length(glm::vec3(proxy_model[1])) +
+                                   glm::length(glm::vec3(proxy_model[2]));
+        return test(key, box, proxy_model, contains_camera(world_center, world_radius));
+    }
+
+    // Tests a world space sphere, see test_box
+    bool test_sphere(const void* key, const glm::vec3& center, float radius) {
+        glm::mat4 proxy_model(radius * sphere_scale);
+        proxy_model[3] = glm::vec4(center, 1.0f);
+        return test(key, sphere, proxy_model, contains_camera(center, radius));
+    }
+
+    // Objects tested and culled since begin_frame
+    int get_num_tested() const { return num_tested; }
+    int get_num_culled() const { return num_culled; }
+
+   private:
+    static constexpr uint64_t EVICT_AFTER_FRAMES = 120;
+
+    struct Entry {
+        GLuint query = 0;
+        bool pending = false;  // issued, result not read yet
+        bool visible = true;
+        uint64_t last_frame = 0;
+    };
+    struct Proxy {
+        GLuint vao = 0, vbo = 0, ibo = 0;
+        GLsizei index_count = 0;
+    };
+
+    bool contains_camera(const glm::vec3& center, float radius) const {
+        const glm::vec3 offset = camera_position - center;
+        const float reach = radius + near_plane;
+        return glm::dot(offset, offset) <= reach * reach;
+    }
+
+    bool test(const void* key, const Proxy& proxy, const glm::mat4& proxy_model,
+              bool camera_inside) {
+        if (!enabled) return true;
+
+        Entry& entry = entries[key];
+        if (entry.query == 0) glGenQueries(1, &entry.query);
+        if (entry.pending) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint passed = 0;
+                glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT, &passed);
+                entry.visible = passed != 0;
+                entry.pending = false;
+            }
+        }
+        if (entry.last_frame + 1 < frame || camera_inside) entry.visible = true;
+        entry.last_frame = frame;
+
+        // one query in flight per object, the next one goes out once it's read
+        if (!entry.pending && !camera_inside) {
+            draw_proxy(proxy, proxy_model, entry.query);
+            entry.pending = true;
+        }
+
+        num_tested++;
+        if (!entry.visible) num_culled++;
+        return entry.visible;
+    }
+
+    void draw_proxy(const Proxy& proxy, const glm::mat4& proxy_model, GLuint query) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_DEPTH_TEST);
+        // back faces count too, in case the near plane cuts the front ones
+        glDisable(GL_CULL_FACE);
+
+        shader.bind();
+        const glm::mat4 mvp = view_projection * proxy_model;
+        glUniformMatrix4fv(shader.getUniformLocation("mvpMatrix"), 1, GL_FALSE,
+                           glm::value_ptr(mvp));
+        glBindVertexArray(proxy.vao);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+        glDrawElements(GL_TRIANGLES, proxy.index_count, GL_UNSIGNED_INT, nullptr);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        glBindVertexArray(0);
+
+        // back to the default state
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_CULL_FACE);
+    }
+
+    static void upload(Proxy& proxy, const std::vector<glm::vec3>& vertices,
+                       const std::vector<GLuint>& indices) {
+        glGenVertexArrays(1, &proxy.vao);
+        glBindVertexArray(proxy.vao);
+        glGenBuffers(1, &proxy.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, proxy.vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertices.size() * sizeof(glm::vec3)),
+                     vertices.data(), GL_STATIC_DRAW);
+        glGenBuffers(1, &proxy.ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, proxy.ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(GLuint)),
+                     indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+        glBindVertexArray(0);
+        proxy.index_count = (GLsizei)indices.size();
+    }
+
+    void build_box() {
+        std::vector<glm::vec3> vertices;
+        for (int i = 0; i < 8; i++) {
+            vertices.emplace_back(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f,
+                                  i & 4 ? 1.0f : -1.0f);
+        }
+        const std::vector<GLuint> indices = {
+            0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 1, 4, 1, 5, 4,
+            2, 6, 3, 3, 6, 7,  0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5};
+        upload(box, vertices, indices);
+    }
+
+    // Latitude-longitude sphere, scaled so its flat faces stay outside the
+    // unit sphere
+    void build_sphere() {
+        constexpr int RINGS = 8;
+        constexpr int SEGMENTS = 16;
+        std::vector<glm::vec3> vertices;
+        for (int ring = 0; ring <= RINGS; ring++) {
+            const float theta = glm::pi<float>() * (float)ring / RINGS;
+            for (int segment = 0; segment < SEGMENTS; segment++) {
+                const float phi = glm::two_pi<float>() * (float)segment / SEGMENTS;
+                vertices.emplace_back(glm::sin(theta) * glm::cos(phi), glm::cos(theta),
+                                      glm::sin(theta) * glm::sin(phi));
+            }
+        }
+        std::vector<GLuint> indices;
+        for (int ring = 0; ring < RINGS; ring++) {
+            for (int segment = 0; segment < SEGMENTS; segment++) {
+                const GLuint a = (GLuint)(ring * SEGMENTS + segment);
+                const GLuint b = (GLuint)(ring * SEGMENTS + (segment + 1) % SEGMENTS);
+                const GLuint c = a + SEGMENTS;
+                const GLuint d = b + SEGMENTS;
+                indices.insert(indices.end(), {a, c, b, b, c, d});
+            }
+        }
+
+        // closest plane of any (non-degenerate) triangle to the center
+        float min_distance = 1.0f;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const glm::vec3& p0 = vertices[indices[i]];
+            const glm::vec3 normal =
+                glm::cross(vertices[indices[i + 1]] - p0, vertices[indices[i + 2]] - p0);
+            if (glm::length(normal) < 1e-6f) continue;
+            min_distance = std::min(min_distance, glm::abs(glm::dot(glm::normalize(normal), p0)));
+        }
+        sphere_scale = 1.0f / min_distance;
+        upload(sphere, vertices, indices);
+    }
+
+    Shader shader;
+    Proxy box;
+    Proxy sphere;
+    float sphere_scale = 1.0f;
+
+    std::unordered_map<const void*, Entry> entries;
+    uint64_t frame = 1;
+    glm::mat4 view_projection{1.0f};
+    glm::vec3 camera_position{0.0f};
+    float near_plane = 0.1f;
+    int num_tested = 0;
+    int num_culled = 0;
+};
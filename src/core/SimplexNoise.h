@@ -0,0 +1,109 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+// CPU copy of the 3D simplex noise in shaders/bodies/earth_tese.glsl
+// (Ian McEwan, Ashima Arts / stegu, webgl-noise, MIT license).
+//
+// Kept operation for operation in float like the shader, so terrain heights
+// computed on the CPU (collision) match the displaced surface that is drawn.
+// glm's own simplex() is an older revision of the same code with a different
+// permutation and does NOT match. Change both together.
+namespace simplex_noise_detail {
+
+inline glm::vec3 mod289(const glm::vec3& x) {
+    return x - glm::floor(x * (1.0f / 289.0f)) * 289.0f;
+}
+
+inline glm::vec4 mod289(const glm::vec4& x) {
+    return x - glm::floor(x * (1.0f / 289.0f)) * 289.0f;
+}
+
+inline glm::vec4 permute(const glm::vec4& x) {
+    return mod289(((x * 34.0f) + 10.0f) * x);
+}
+
+inline glm::vec4 taylor_inv_sqrt(const glm::vec4& r) {
+    return 1.79284291400159f - 0.85373472095314f * r;
+}
+
+}  // namespace simplex_noise_detail
+
+// Noise in about [-1, 1]
+inline float snoise(const glm::vec3& v) {
+    using namespace simplex_noise_detail;
+    const glm::vec2 C(1.0f / 6.0f, 1.0f / 3.0f);
+    const glm::vec4 D(0.0f, 0.5f, 1.0f, 2.0f);
+
+    // First corner
+    glm::vec3 i = glm::floor(v + glm::dot(v, glm::vec3(C.y)));
+    const glm::vec3 x0 = v - i + glm::dot(i, glm::vec3(C.x));
+
+    // Other corners
+    const glm::vec3 g = glm::step(glm::vec3(x0.y, x0.z, x0.x), x0);
+    const glm::vec3 l = 1.0f - g;
+    const glm::vec3 i1 = glm::min(g, glm::vec3(l.z, l.x, l.y));
+    const glm::vec3 i2 = glm::max(g, glm::vec3(l.z, l.x, l.y));
+
+    const glm::vec3 x1 = x0 - i1 + C.x;
+    const glm::vec3 x2 = x0 - i2 + C.y;
+    const glm::vec3 x3 = x0 - D.y;
+
+    // Permutations
+    i = mod289(i);
+    const glm::vec4 p =
+        permute(permute(permute(i.z + glm::vec4(0.0f, i1.z, i2.z, 1.0f)) + i.y +
+                        glm::vec4(0.0f, i1.y, i2.y, 1.0f)) +
+                i.x + glm::vec4(0.0f, i1.x, i2.x, 1.0f));
+
+    // Gradients: 7x7 points over a square, mapped onto an octahedron
+    const float n_ = 0.142857142857f;  // 1.0/7.0
+    const glm::vec3 ns = n_ * glm::vec3(D.w, D.y, D.z) - glm::vec3(D.x, D.z, D.x);
+
+    const glm::vec4 j = p - 49.0f * glm::floor(p * ns.z * ns.z);  // mod(p,7*7)
+
+    const glm::vec4 x_ = glm::floor(j * ns.z);
+    const glm::vec4 y_ = glm::floor(j - 7.0f * x_);  // mod(j,N)
+
+    const glm::vec4 x = x_ * ns.x + ns.y;
+    const glm::vec4 y = y_ * ns.x + ns.y;
+    const glm::vec4 h = 1.0f - glm::abs(x) - glm::abs(y);
+
+    const glm::vec4 b0(x.x, x.y, y.x, y.y);
+    const glm::vec4 b1(x.z, x.w, y.z, y.w);
+
+    const glm::vec4 s0 = glm::floor(b0) * 2.0f + 1.0f;
+    const glm::vec4 s1 = glm::floor(b1) * 2.0f + 1.0f;
+    const glm::vec4 sh = -glm::step(h, glm::vec4(0.0f));
+
+    const glm::vec4 a0 = glm::vec4(b0.x, b0.z, b0.y, b0.w) +
+                         glm::vec4(s0.x, s0.z, s0.y, s0.w) * glm::vec4(sh.x, sh.x, sh.y, sh.y);
+    const glm::vec4 a1 = glm::vec4(b1.x, b1.z, b1.y, b1.w) +
+                         glm::vec4(s1.x, s1.z, s1.y, s1.w) * glm::vec4(sh.z, sh.z, sh.w, sh.w);
+
+    glm::vec3 p0(a0.x, a0.y, h.x);
+    glm::vec3 p1(a0.z, a0.w, h.y);
+    glm::vec3 p2(a1.x, a1.y, h.z);
+    glm::vec3 p3(a1.z, a1.w, h.w);
+
+    // Normalise gradients
+    const glm::vec4 norm = taylor_inv_sqrt(
+        glm::vec4(glm::dot(p0, p0), glm::dot(p1, p1), glm::dot(p2, p2), glm::dot(p3, p3)));
+    p0 *= norm.x;
+    p1 *= norm.y;
+    p2 *= norm.z;
+    p3 *= norm.w;
+
+    // Mix final noise value
+    const glm::vec4 m = glm::max(
+        0.5f - glm::vec4(glm::dot(x0, x0), glm::dot(x1, x1), glm::dot(x2, x2), glm::dot(x3, x3)),
+        0.0f);
+    const glm::vec4 m2 = m * m;
+    const glm::vec4 m4 = m2 * m2;
+    const glm::vec4 pdotx(glm::dot(p0, x0), glm::dot(p1, x1), glm::dot(p2, x2), glm::dot(p3, x3));
+
+    return 105.0f * glm::dot(m4, pdotx);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Uniform grid over points, hashed into a table of buckets so it needs no
+// bounds. Rebuilt from scratch with a counting sort, which for a few hundred
+// thousand points is cheaper than updating it incrementally.
+//
+// Points are stored sorted by bucket: a query visits "slots" of that order,
+// and get_point_index(slot) maps a slot back to the input index. Callers that
+// scan neighbors often should gather their per-point data in slot order.
+class SpatialHashGrid {
+   public:
+    // Queries find every point within cell_size of the query point
+    void build(const std::vector<glm::vec3>& points, float new_cell_size,
+               ThreadPool* thread_pool = nullptr) {
+        cell_size = new_cell_size;
+        inv_cell_size = 1.0f / cell_size;
+        const int count = static_cast<int>(points.size());
+
+        // about two buckets per point keeps collisions rare
+        uint32_t table_size = 64;
+        while (table_size < 2u * static_cast<uint32_t>(count)) table_size *= 2;
+        mask = table_size - 1;
+
+        point_buckets.resize(points.size());
+        auto hash_points = [&](int begin, int end) {
+            for (size_t i = static_cast<size_t>(begin); i < static_cast<size_t>(end); i++) {
+                point_buckets[i] = bucket_of(cell_of(points[i]));
+            }
+        };
+        if (thread_pool != nullptr) {
+            thread_pool->parallel_for(count, 4096, hash_points);
+        } else {
+            hash_points(0, count);
+        }
+
+        bucket_starts.assign(table_size + 1, 0);
+        for (uint32_t bucket : point_buckets) bucket_starts[bucket + 1]++;
+        for (uint32_t b = 0; b < table_size; b++) bucket_starts[b + 1] += bucket_starts[b];
+
+        slots.resize(points.size());
+        std::vector<uint32_t> cursor(bucket_starts.begin(), bucket_starts.end() - 1);
+        for (uint32_t i = 0; i < static_cast<uint32_t>(count); i++) {
+            slots[cursor[point_buckets[i]]++] = i;
+        }
+    }
+
+    // Calls f(slot) for every point in the 27 cells around p, each once.
+    // Points of other cells hashing to the same buckets are included too, so
+    // callers filter by distance; everything within cell_size of p is visited.
+    template <typename F>
+    void for_each_near(const glm::vec3& p, F&& f) const {
+        const glm::ivec3 center = cell_of(p);
+
+        // The three cells of a row are consecutive buckets, so a row is one
+        // slot range (two if it wraps around the table). Rows can collide, so
+        // overlapping ranges are merged before visiting.
+        std::array<std::pair<uint32_t, uint32_t>, 18> ranges;
+        size_t range_count = 0;
+        for (int z = center.z - 1; z <= center.z + 1; z++) {
+            for (int y = center.y - 1; y <= center.y + 1; y++) {
+                const uint32_t first = bucket_of(glm::ivec3(center.x - 1, y, z));
+                if (first + 2 <= mask) {
+                    ranges[range_count++] = {bucket_starts[first], bucket_starts[first + 3]};
+                } else {
+                    ranges[range_count++] = {bucket_starts[first], bucket_starts[mask + 1]};
+                    ranges[range_count++] = {0, bucket_starts[(first + 3) & mask]};
+                }
+            }
+        }
+        std::sort(ranges.begin(), ranges.begin() + range_count);
+
+        uint32_t visited_end = 0;
+        for (size_t r = 0; r < range_count; r++) {
+            for (uint32_t slot = std::max(ranges[r].first, visited_end); slot < ranges[r].second; slot++) {
+                f(slot);
+            }
+            visited_end = std::max(visited_end, ranges[r].second);
+        }
+    }
+
+    uint32_t get_point_index(uint32_t slot) const { return slots[slot]; }
+    // Input indices of the points in slot order
+    const std::vector<uint32_t>& get_slots() const { return slots; }
+    float get_cell_size() const { return cell_size; }
+
+   private:
+    glm::ivec3 cell_of(const glm::vec3& p) const {
+        return glm::ivec3(glm::floor(p * inv_cell_size));
+    }
+
+    // Rows along x are hashed together and x added afterwards, so cells
+    // next to each other in x land in consecutive buckets
+    uint32_t bucket_of(const glm::ivec3& cell) const {
+        const uint32_t row = (static_cast<uint32_t>(cell.y) * 19349663u) ^
+                             (static_cast<uint32_t>(cell.z) * 83492791u);
+        return (row + static_cast<uint32_t>(cell.x)) & mask;
+    }
+
+    float cell_size = 1.0f;
+    float inv_cell_size = 1.0f;
+    uint32_t mask = 0;
+    std::vector<uint32_t> point_buckets;  // per input point
+    std::vector<uint32_t> bucket_starts;  // slot range of each bucket
+    std::vector<uint32_t> slots;          // input indices sorted by bucket
+};
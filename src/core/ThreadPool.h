@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running queued jobs.
+//
+// Jobs are submitted to a TaskGroup, which wait() blocks on. A waiting thread
+// runs the group's queued jobs itself instead of sleeping, so a job can wait
+// on jobs it submitted without deadlocking, and a pool without workers still
+// works. It never picks up other groups' jobs: a long job queued by someone
+// else (the particle simulation) would otherwise serialize behind a short
+// parallel_for on the waiting thread.
+class ThreadPool {
+   public:
+    class TaskGroup {
+        friend class ThreadPool;
+        std::atomic<int> pending{0};
+
+       public:
+        bool is_done() const { return pending.load(std::memory_order_acquire) == 0; }
+    };
+
+    explicit ThreadPool(int thread_count = default_thread_count()) {
+        for (int i = 0; i < thread_count; i++) {
+            workers.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void submit(TaskGroup& group, std::function<void()> job) {
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({&group, std::move(job)});
+        }
+        work_available.notify_one();
+        // a thread blocked in wait() on the group may pick it up too
+        job_finished.notify_all();
+    }
+
+    // Returns once every job of the group finished, running the group's
+    // queued jobs in the meantime
+    void wait(TaskGroup& group) {
+        while (!group.is_done()) {
+            if (run_one(group)) continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            job_finished.wait(lock, [&]() { return group.is_done() || find_job(group) != queue.end(); });
+        }
+    }
+
+    // Calls body(begin, end) on chunks of [0, count) in parallel and returns
+    // when all are done. Chunks are at least min_chunk long.
+    template <typename Body>
+    void parallel_for(int count, int min_chunk, Body&& body) {
+        if (count <= 0) return;
+        int chunks = std::clamp(count / std::max(min_chunk, 1), 1, get_thread_count() + 1);
+        if (chunks == 1) {
+            body(0, count);
+            return;
+        }
+
+        TaskGroup group;
+        int chunk_size = (count + chunks - 1) / chunks;
+        for (int begin = chunk_size; begin < count; begin += chunk_size) {
+            int end = std::min(begin + chunk_size, count);
+            submit(group, [&body, begin, end]() { body(begin, end); });
+        }
+        body(0, std::min(chunk_size, count));  // first chunk on this thread
+        wait(group);
+    }
+
+    int get_thread_count() const { return static_cast<int>(workers.size()); }
+
+    // One thread less than the hardware has; the main thread works too
+    static int default_thread_count() {
+        return std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+
+   private:
+    struct Job {
+        TaskGroup* group;
+        std::function<void()> function;
+    };
+
+    void worker_loop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&]() { return stopping || !queue.empty(); });
+                if (stopping && queue.empty()) return;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            run(job);
+        }
+    }
+
+    // Oldest queued job of the group, call with the mutex held
+    std::deque<Job>::iterator find_job(const TaskGroup& group) {
+        return std::find_if(queue.begin(), queue.end(),
+                            [&](const Job& job) { return job.group == &group; });
+    }
+
+    // Runs one queued job of the group on the calling thread, false if there
+    // was none
+    bool run_one(const TaskGroup& group) {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = find_job(group);
+            if (it == queue.end()) return false;
+            job = std::move(*it);
+            queue.erase(it);
+        }
+        run(job);
+        return true;
+    }
+
+    void run(Job& job) {
+        job.function();
+        if (job.group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // taking the lock orders this with the predicate check in wait()
+            std::lock_guard<std::mutex> lock(mutex);
+            job_finished.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable job_finished;
+    std::deque<Job> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// Streaming buffer for per-frame dynamic data (instance attributes etc).
+//
+// In Fenced mode the buffer is split into `region_count` regions that are
+// written round-robin through unsynchronized mappings; a fence placed after
+// the draw that reads a region is waited on before the region is reused, so
+// the CPU never writes memory the GPU may still be reading. Orphan mode
+// re-specifies the storage every upload and lets the driver do the renaming.
+// SubData overwrites the same storage in place, as plain glBufferSubData
+// code does; it is kept to compare stalls against.
+//
+// GL 4.1 has no persistent mapping, so Fenced mode maps and unmaps per upload.
+class UploadRing {
+   public:
+    enum class Mode { SubData = 0, Orphan, Fenced };
+
+    UploadRing(GLenum buffer_target, size_t initial_region_size, size_t num_regions = 3)
+        : target(buffer_target), region_count(num_regions) {
+        glGenBuffers(1, &buffer);
+        allocate(initial_region_size);
+    }
+
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    ~UploadRing() {
+        release_fences();
+        glDeleteBuffers(1, &buffer);
+    }
+
+    // Copies `size` bytes into the next free region and returns the byte
+    // offset of the data in get_buffer(). Leaves the buffer bound to target.
+    size_t upload(const void* data, size_t size) {
+        auto start = std::chrono::steady_clock::now();
+        wait_ms = 0.0f;
+        if (size > region_size) {
+            allocate(std::max(size, region_size * 2));
+        }
+
+        size_t offset = 0;
+        glBindBuffer(target, buffer);
+        switch (mode) {
+            case Mode::SubData:
+                glBufferSubData(target, 0, (GLsizeiptr)size, data);
+                break;
+            case Mode::Orphan:
+                glBufferData(target, (GLsizeiptr)region_size, nullptr, GL_STREAM_DRAW);
+                glBufferSubData(target, 0, (GLsizeiptr)size, data);
+                break;
+            case Mode::Fenced: {
+                current = (current + 1) % region_count;
+                wait_for_region(current);
+                offset = current * region_size;
+                void* ptr = glMapBufferRange(
+                    target, (GLintptr)offset, (GLsizeiptr)size,
+                    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                        GL_MAP_INVALIDATE_RANGE_BIT);
+                if (ptr != nullptr) {
+                    std::memcpy(ptr, data, size);
+                    glUnmapBuffer(target);
+                } else {
+                    glBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, data);
+                }
+                break;
+            }
+        }
+        upload_ms = elapsed_ms(start);
+        return offset;
+    }
+
+    // Call after the draw calls reading the last upload were issued
+    void fence() {
+        if (mode != Mode::Fenced) return;
+        if (fences[current] != nullptr) glDeleteSync(fences[current]);
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void set_mode(Mode new_mode) {
+        if (new_mode == mode) return;
+        release_fences();
+        mode = new_mode;
+        // fresh storage, draws still in flight keep reading the old one
+        allocate(region_size);
+    }
+
+    Mode get_mode() const { return mode; }
+    GLuint get_buffer() const { return buffer; }
+
+    // CPU time of the last upload, including any wait for the GPU
+    float get_upload_ms() const { return upload_ms; }
+    // Part of the last upload spent waiting on a fence (Fenced mode only)
+    float get_wait_ms() const { return wait_ms; }
+
+   private:
+    void allocate(size_t new_region_size) {
+        release_fences();
+        region_size = new_region_size;
+        size_t total = mode == Mode::Fenced ? region_size * region_count : region_size;
+        glBindBuffer(target, buffer);
+        glBufferData(target, (GLsizeiptr)total, nullptr, GL_STREAM_DRAW);
+        fences.assign(region_count, nullptr);
+        current = 0;
+    }
+
+    void wait_for_region(size_t region) {
+        wait_ms = 0.0f;
+        GLsync fence = fences[region];
+        if (fence == nullptr) return;
+
+        auto start = std::chrono::steady_clock::now();
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);  // 1 ms
+        }
+        glDeleteSync(fence);
+        fences[region] = nullptr;
+        wait_ms = elapsed_ms(start);
+    }
+
+    void release_fences() {
+        for (GLsync& fence : fences) {
+            if (fence != nullptr) glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    static float elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    GLenum target;
+    GLuint buffer = 0;
+    size_t region_count;
+    size_t region_size = 0;
+    size_t current = 0;
+    std::vector<GLsync> fences;
+    Mode mode = Mode::Fenced;
+
+    float upload_ms = 0.0f;
+    float wait_ms = 0.0f;
+};
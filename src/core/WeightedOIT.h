@@ -0,0 +1,179 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+#include <framework/shader.h>
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+DISABLE_WARNINGS_POP()
+
+#include <iostream>
+
+// Weighted blended order-independent transparency (McGuire & Bavoil 2013).
+//
+// Transparent geometry is drawn into an accumulation target (RGBA16F,
+// premultiplied color * weight) and a revealage target (R8, product of
+// 1 - alpha), then composite() resolves both over the bound framebuffer.
+// The scene depth is copied in first so opaque geometry still occludes; the
+// depth attachment takes the default framebuffer's depth format, as
+// glBlitFramebuffer needs matching formats.
+//
+// Fragment shaders drawing into it write location 0 = accumulation and
+// location 1 = revealage, see particle_oit_frag.glsl.
+class WeightedOIT {
+   public:
+    WeightedOIT() {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &accum_texture);
+        glGenTextures(1, &reveal_texture);
+        glGenRenderbuffers(1, &depth_renderbuffer);
+        glGenVertexArrays(1, &empty_vao);
+
+        try {
+            composite_shader =
+                ShaderBuilder()
+                    .addStage(GL_VERTEX_SHADER,
+                              RESOURCE_ROOT "shaders/fullscreen_vert.glsl")
+                    .addStage(GL_FRAGMENT_SHADER,
+                              RESOURCE_ROOT "shaders/oit_composite_frag.glsl")
+                    .build();
+        } catch (const ShaderLoadingException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    WeightedOIT(const WeightedOIT&) = delete;
+    WeightedOIT& operator=(const WeightedOIT&) = delete;
+
+    ~WeightedOIT() {
+        glDeleteVertexArrays(1, &empty_vao);
+        glDeleteRenderbuffers(1, &depth_renderbuffer);
+        glDeleteTextures(1, &reveal_texture);
+        glDeleteTextures(1, &accum_texture);
+        glDeleteFramebuffers(1, &fbo);
+    }
+
+    // Binds and clears the OIT targets at the size of the default
+    // framebuffer, copies its depth and sets up the blending.
+    void begin(int framebuffer_width, int framebuffer_height) {
+        resize(framebuffer_width, framebuffer_height);
+
+        const GLfloat zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const GLfloat one[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        if (has_scene_depth) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                              GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        } else {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glDepthMask(GL_TRUE);
+            glClearBufferfv(GL_DEPTH, 0, one);
+        }
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClearBufferfv(GL_COLOR, 1, one);
+
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFunci(0, GL_ONE, GL_ONE);
+        glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    }
+
+    // Resolves the accumulated fragments over the default framebuffer
+    void composite() {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        composite_shader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, accum_texture);
+        glUniform1i(composite_shader.getUniformLocation("accumTexture"), 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, reveal_texture);
+        glUniform1i(composite_shader.getUniformLocation("revealTexture"), 1);
+
+        glBindVertexArray(empty_vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+
+   private:
+    void resize(int new_width, int new_height) {
+        if (new_width == width && new_height == height) return;
+        width = new_width;
+        height = new_height;
+
+        auto allocate = [&](GLuint texture, GLint internal_format, GLenum format, GLenum type) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0,
+                         format, type, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        };
+        allocate(accum_texture, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+        allocate(reveal_texture, GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (depth_format == 0) query_depth_format();
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, depth_format, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, accum_texture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                               GL_TEXTURE_2D, reveal_texture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, depth_attachment,
+                                  GL_RENDERBUFFER, depth_renderbuffer);
+        const GLenum draw_buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, draw_buffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Weighted OIT framebuffer is incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Picks the depth format of the default framebuffer. It is fixed when the
+    // window is created, so this runs once.
+    void query_depth_format() {
+        GLint depth_bits = 0;
+        GLint stencil_bits = 0;
+        GLint depth_type = GL_UNSIGNED_NORMALIZED;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGetFramebufferAttachmentParameteriv(
+            GL_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
+        glGetFramebufferAttachmentParameteriv(
+            GL_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &depth_type);
+        glGetFramebufferAttachmentParameteriv(
+            GL_FRAMEBUFFER, GL_STENCIL, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencil_bits);
+
+        const bool stencil = stencil_bits > 0;
+        if (depth_type == GL_FLOAT) {
+            depth_format = stencil ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+        } else if (depth_bits <= 16 && !stencil) {
+            depth_format = GL_DEPTH_COMPONENT16;
+        } else if (depth_bits > 24 && !stencil) {
+            depth_format = GL_DEPTH_COMPONENT32;
+        } else {
+            depth_format = stencil ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24;
+        }
+        depth_attachment = stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        has_scene_depth = depth_bits > 0;
+    }
+
+    GLuint fbo = 0;
+    GLuint accum_texture = 0;
+    GLuint reveal_texture = 0;
+    GLuint depth_renderbuffer = 0;
+    GLenum depth_format = 0;  // matches the default framebuffer's depth
+    GLenum depth_attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+    bool has_scene_depth = true;
+    GLuint empty_vao = 0;
+    int width = 0;
+    int height = 0;
+    Shader composite_shader;
+};
@@ -2,6 +2,7 @@
 
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 DISABLE_WARNINGS_POP()
 #include <toml/toml.hpp>
@@ -9,6 +10,8 @@ DISABLE_WARNINGS_POP()
 #include <optional>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 class Config {
 public:
@@ -25,6 +28,48 @@ public:
         float orbit_period;
     };
 
+    // Procedurally generated asteroid belt around a body ([[planets.belts]])
+    struct BeltInfo {
+        int parent_id;
+        float inner_radius;
+        float outer_radius;
+        int count;
+        // Power-law size distribution p(s) ~ s^-size_exponent in [min, max]
+        float min_size;
+        float max_size;
+        float size_exponent;
+        float thickness;
+        glm::vec3 orbit_normal;
+        float orbit_period;  // at inner_radius, outer parts follow Kepler's 3rd law
+        unsigned int seed;
+    };
+
+    // Particle emitter on the battlecruiser ([[battlecruiser.thrusters.emitters]])
+    struct EmitterInfo {
+        std::string name;
+        std::vector<glm::vec3> positions;  // in battlecruiser model space
+        float rate;            // particles per second at every position
+        int max_per_frame;     // per position, caps spawning after a long frame
+        int burst;             // extra particles per position every burst_interval
+        float burst_interval;  // seconds, 0 disables bursts
+        std::string shape;     // "point", "disc" or "sphere"
+        float radius;
+        float cone_angle;      // degrees
+        float velocity_spread;
+        glm::vec3 initial_velocity;
+        // Lifetime curve, see ParticleSpawnParams
+        float life;
+        float life_deviation;
+        float fade_out;
+        float size;
+        float size_deviation;
+        float size_growth;
+        glm::vec2 color_r;  // 0-255 ranges per channel
+        glm::vec2 color_g;
+        glm::vec2 color_b;
+        int budget;  // most particles alive at once from this emitter, 0 = no limit
+    };
+
     std::string window_title;
     int window_initial_width;
     int window_initial_height;
@@ -36,7 +81,38 @@ public:
     float freecam_look_speed;
 
     int planets_ico_mesh_resolution;
+    int star_surface_resolution;
+    float star_surface_update_rate;
+    bool star_surface_interpolate;
+    int ocean_detail_resolution;
     std::vector<PlanetInfo> planets;
+    std::vector<BeltInfo> belts;
+
+    int particle_pool_size;
+    std::vector<EmitterInfo> emitters;
+
+    // Render pass per battlecruiser material name ([battlecruiser.materials]),
+    // materials not listed use battlecruiser_default_pass
+    std::vector<std::pair<std::string, std::string>> battlecruiser_material_passes;
+    std::string battlecruiser_default_pass;
+
+    // Instanced battlecruisers sharing the player's model ([battlecruiser.fleet])
+    int fleet_count;
+    float fleet_spacing;
+    glm::vec3 fleet_center;
+    glm::vec2 fleet_lod_thresholds;  // projected sizes switching to LOD 1 and 2
+    bool fleet_simulate;             // flocking, see FleetSimulation
+    float fleet_neighbor_radius;
+    float fleet_max_speed;
+
+    // Dynamic reflections of the battlecruiser's glass ([battlecruiser.probe]),
+    // see EnvironmentProbe
+    int probe_resolution;
+    int probe_faces_per_frame;
+
+    // Ships closer than this to a body's surface are reported as near it
+    // ([collision]), see CollisionWorld
+    float collision_proximity_margin;
 
     bool enable_eclipse_shadows;
     bool enable_shadow_mapping_planets;
@@ -62,6 +138,10 @@ public:
         freecam_look_speed = data["camera"]["freecam"]["look_speed"].value_or(0.035f);
 
         planets_ico_mesh_resolution = data["planets"]["ico_mesh_resolution"].value_or(5);
+        star_surface_resolution = data["planets"]["star_surface_resolution"].value_or(256);
+        star_surface_update_rate = data["planets"]["star_surface_update_rate"].value_or(12.0f);
+        star_surface_interpolate = data["planets"]["star_surface_interpolate"].value_or(true);
+        ocean_detail_resolution = data["planets"]["ocean_detail_resolution"].value_or(512);
 
         // Get the underlying array object for planets_info
         if (toml::array* planets_array = data["planets"]["planets_info"].as_array()) {
@@ -86,12 +166,123 @@ public:
             });
         }
 
+        belts.clear();
+        if (toml::array* belts_array = data["planets"]["belts"].as_array()) {
+            belts_array->for_each([&](auto&& belt) {
+                toml::table* belt_table = belt.as_table();
+                if (!belt_table) {
+                    std::cerr << "Error: Expected table for belt info, got "
+                              << belt.type() << std::endl;
+                    return;
+                }
+
+                toml::table& b = *belt_table;
+                BeltInfo info;
+                info.parent_id = b["parent_id"].value_or(0);
+                info.inner_radius = b["inner_radius"].value_or(10.0f);
+                info.outer_radius = b["outer_radius"].value_or(15.0f);
+                info.count = b["count"].value_or(10000);
+                info.min_size = b["min_size"].value_or(0.01f);
+                info.max_size = b["max_size"].value_or(0.1f);
+                info.size_exponent = b["size_exponent"].value_or(2.5f);
+                info.thickness = b["thickness"].value_or(0.5f);
+                info.orbit_normal = tomlArrayToVec3(b["orbit_normal"].as_array())
+                                        .value_or(glm::vec3(0.0f, 1.0f, 0.0f));
+                info.orbit_period = b["orbit_period"].value_or(60.0f);
+                info.seed = b["seed"].value_or(1234u);
+                belts.push_back(info);
+            });
+        }
+
+        battlecruiser_material_passes.clear();
+        if (toml::table* materials = data["battlecruiser"]["materials"].as_table()) {
+            for (auto&& [name, pass] : *materials) {
+                if (!pass.is_string()) {
+                    std::cerr << "Error: Expected a pass name for material " << name.str()
+                              << ", got " << pass.type() << std::endl;
+                    continue;
+                }
+                battlecruiser_material_passes.emplace_back(std::string(name.str()),
+                                                           pass.value_or(std::string("opaque")));
+            }
+        }
+        battlecruiser_default_pass = data["battlecruiser"]["default_pass"].value_or("opaque");
+
+        fleet_count = data["battlecruiser"]["fleet"]["count"].value_or(0);
+        fleet_spacing = data["battlecruiser"]["fleet"]["spacing"].value_or(5.0f);
+        fleet_center = tomlArrayToVec3(data["battlecruiser"]["fleet"]["center"].as_array())
+                           .value_or(glm::vec3(0.0f));
+        fleet_lod_thresholds = tomlArrayToVec2(data["battlecruiser"]["fleet"]["lod_thresholds"].as_array())
+                                   .value_or(glm::vec2(0.2f, 0.05f));
+        fleet_simulate = data["battlecruiser"]["fleet"]["simulate"].value_or(false);
+        fleet_neighbor_radius = data["battlecruiser"]["fleet"]["neighbor_radius"].value_or(8.0f);
+        fleet_max_speed = data["battlecruiser"]["fleet"]["max_speed"].value_or(4.0f);
+
+        probe_resolution = data["battlecruiser"]["probe"]["resolution"].value_or(128);
+        probe_faces_per_frame = data["battlecruiser"]["probe"]["faces_per_frame"].value_or(1);
+
+        collision_proximity_margin = data["collision"]["proximity_margin"].value_or(1.0f);
+
+        particle_pool_size = data["battlecruiser"]["thrusters"]["pool_size"].value_or(100000);
+        emitters.clear();
+        if (toml::array* emitters_array = data["battlecruiser"]["thrusters"]["emitters"].as_array()) {
+            emitters_array->for_each([&](auto&& emitter) {
+                toml::table* emitter_table = emitter.as_table();
+                if (!emitter_table) {
+                    std::cerr << "Error: Expected table for emitter info, got "
+                              << emitter.type() << std::endl;
+                    return;
+                }
+
+                toml::table& e = *emitter_table;
+                EmitterInfo info;
+                info.name = e["name"].value_or("emitter");
+                if (toml::array* positions = e["positions"].as_array()) {
+                    for (toml::node& position : *positions) {
+                        info.positions.push_back(
+                            tomlArrayToVec3(position.as_array()).value_or(glm::vec3(0.0f)));
+                    }
+                }
+                info.rate = e["rate"].value_or(1000.0f);
+                info.max_per_frame = e["max_per_frame"].value_or(500);
+                info.burst = e["burst"].value_or(0);
+                info.burst_interval = e["burst_interval"].value_or(0.0f);
+                info.shape = e["shape"].value_or("disc");
+                info.radius = e["radius"].value_or(0.2f);
+                info.cone_angle = e["cone_angle"].value_or(30.0f);
+                info.velocity_spread = e["velocity_spread"].value_or(0.2f);
+                info.initial_velocity = tomlArrayToVec3(e["initial_velocity"].as_array())
+                                            .value_or(glm::vec3(0.0f));
+                info.life = e["life"].value_or(1.0f);
+                info.life_deviation = e["life_deviation"].value_or(0.5f);
+                info.fade_out = e["fade_out"].value_or(0.5f);
+                info.size = e["size"].value_or(0.06f);
+                info.size_deviation = e["size_deviation"].value_or(0.06f);
+                info.size_growth = e["size_growth"].value_or(0.0f);
+                info.color_r = tomlArrayToVec2(e["color_r"].as_array()).value_or(glm::vec2(233.0f, 255.0f));
+                info.color_g = tomlArrayToVec2(e["color_g"].as_array()).value_or(glm::vec2(165.0f, 255.0f));
+                info.color_b = tomlArrayToVec2(e["color_b"].as_array()).value_or(glm::vec2(0.0f, 0.0f));
+                info.budget = e["budget"].value_or(0);
+                emitters.push_back(info);
+            });
+        }
+
         enable_eclipse_shadows = data["shadows"]["enable_eclipse_shadows"].value_or(false);
         enable_shadow_mapping_planets = data["shadows"]["enable_shaddow_mapping_planets"].value_or(false);
         shadow_map_size = data["shadows"]["shadow_map_size"].value_or(2048);
     }
 
 private:
+    // Missing or malformed arrays are reported and left to the caller's default
+    std::optional<glm::vec2> tomlArrayToVec2(const toml::array* array) {
+        if (!array) return std::nullopt;
+        if (array->size() != 2 || !(*array)[0].is_number() || !(*array)[1].is_number()) {
+            std::cerr << "Error: Expected an array of 2 numbers, got " << *array << std::endl;
+            return std::nullopt;
+        }
+        return glm::vec2((*array)[0].value_or(0.0f), (*array)[1].value_or(0.0f));
+    }
+
     std::optional<glm::vec3> tomlArrayToVec3(const toml::array* array) {
         glm::vec3 output{};
 
@@ -105,6 +105,11 @@ void GPUMesh::drawPatches(const Shader& drawingShader) {
     glDrawElements(GL_PATCHES, m_numIndices, GL_UNSIGNED_INT, nullptr);
 }
 
+void GPUMesh::drawPatchesInstanced(const Shader& drawingShader, GLsizei instance_count) {
+    glBindVertexArray(m_vao);
+    glDrawElementsInstanced(GL_PATCHES, m_numIndices, GL_UNSIGNED_INT, nullptr, instance_count);
+}
+
 void GPUMesh::moveInto(GPUMesh&& other)
 {
     freeGpuMemory();
@@ -47,6 +47,8 @@ public:
     void draw(const Shader& drawingShader);
 
     void drawPatches(const Shader& drawingShader);
+    // Draw `instance_count` copies of the mesh's patches in a single call.
+    void drawPatchesInstanced(const Shader& drawingShader, GLsizei instance_count);
 
 private:
     void moveInto(GPUMesh&&);
@@ -23,16 +23,24 @@ DISABLE_WARNINGS_POP()
 #include <cmath>
 #include <functional>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include "core/config.h"
+#include "core/EnvironmentProbe.h"
+#include "core/GpuTimer.h"
 #include "core/mesh.h"
+#include "core/OcclusionCuller.h"
+#include "core/ThreadPool.h"
+#include "scene/CollisionWorld.h"
 #include "scene/Skybox.h"
 #include "scene/battlecruiser/Battlecruiser.h"
+#include "scene/battlecruiser/Fleet.h"
 #include "scene/bodies/PlanetSystem.h"
 #include "scene/camera/Camera.h"
 #include "scene/camera/FreeCamera.h"
 #include "scene/camera/BattlecruiserCamera.h"
+#include "texture.h"
 
 int WIDTH_WINDOW = 1280;
 int HEIGHT_WINDOW = 720;
@@ -78,7 +86,28 @@ void load_config(Config &config) {
     }
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Headless CPU benchmarks, no window or config needed
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--bench-particles") {
+            benchmarkParticleKernels(std::cout);
+            benchmarkParticleSpawning(std::cout);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-fleet") {
+            benchmarkFleetSimulation(std::cout);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-bvh") {
+            benchmarkBattlecruiserBVH(std::cout);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-images") {
+            benchmarkImageDecoding(std::cout);
+            return 0;
+        }
+    }
+
     //// -------- Setup:
     /// ---- Load configuration
     Config config;
@@ -122,20 +151,68 @@ int main() {
     // TODO: we might need other projection matrices for other cameras (minimap)
 
     /// ---- Scene setup
+    /// -- Worker threads for loading and simulation
+    ThreadPool thread_pool;
+
     /// -- Planets
-    PlanetSystem planet_system(config);
+    PlanetSystem planet_system(config, thread_pool);
+    // Bodies as seen by ships, refreshed every frame after the bodies moved
+    CollisionWorld collision_world;
 
     /// -- Skybox
-    Skybox skybox;
+    Skybox skybox(thread_pool);
 
     /// -- Battlecruiser
-    Battlecruiser battlecruiser(window);
+    Battlecruiser battlecruiser(window, config);
 
     /// -- Camera Battlecruiser
     BattlecruiserCamera battlecruiserCamera(window, config, battlecruiser);
 
     /// -- Battlecruiser Particles
-    ParticleSystem particles(battlecruiser);
+    ParticleSystem particles(battlecruiser, config, thread_pool);
+
+    /// -- Fleet
+    Fleet fleet(battlecruiser.getMesh(), config, thread_pool);
+    GpuTimer frame_timer;
+
+    /// -- Environment probe reflected by the battlecruiser's glass
+    EnvironmentProbe environment_probe(config.probe_resolution);
+    int probe_faces_per_frame = config.probe_faces_per_frame;
+    bool dynamic_reflections = true;
+    GpuTimer probe_timer;
+
+    /// -- Occlusion culling of bodies, battlecruiser sub-meshes and particles
+    OcclusionCuller occlusion_culler;
+
+    /// -- Mouse picking: right click selects what's under the cursor
+    std::string picked = "nothing";
+    window.registerMouseButtonCallback([&](int button, int action, int mods) {
+        if (button != GLFW_MOUSE_BUTTON_RIGHT || action != GLFW_PRESS ||
+            ImGui::GetIO().WantCaptureMouse) {
+            return;
+        }
+        // ray from the near to the far plane through the cursor
+        const glm::vec2 ndc = window.getNormalizedCursorPos() * 2.0f - 1.0f;
+        const glm::mat4 inverse_view_projection =
+            glm::inverse(projection_matrix * active_camera->get_view_matrix());
+        const glm::vec4 near_point = inverse_view_projection * glm::vec4(ndc, -1.0f, 1.0f);
+        const glm::vec4 far_point = inverse_view_projection * glm::vec4(ndc, 1.0f, 1.0f);
+        Ray ray;
+        ray.origin = glm::vec3(near_point) / near_point.w;
+        ray.direction = glm::vec3(far_point) / far_point.w - ray.origin;
+        ray.t = 1.0f;
+
+        // every hit shortens the ray, so the last one is the closest
+        picked = "nothing";
+        const int body = planet_system.pick(ray);
+        if (body >= 0) {
+            planet_system.set_selected_body(body);
+            picked = "body " + std::to_string(body);
+        }
+        const int ship = fleet.pick(ray);
+        if (ship >= 0) picked = "fleet ship " + std::to_string(ship);
+        if (battlecruiser.pick(ray)) picked = "battlecruiser";
+    });
 
     window.registerKeyCallback([&](int key, int scancode, int action, int mods) {
         if (action == GLFW_PRESS) {
@@ -167,15 +244,20 @@ int main() {
         window.updateInput();
         /// -- Update cameras
         freecam.update_input();
+
+        /// -- Update bodies, ships collide with where they are now
+        planet_system.update(time_warp * (float) delta_time);
+        collision_world.update(planet_system.get_bodies());
+
         // -- Update battlecruiser
-        battlecruiser.updateVelocityPosition(static_cast<float>(delta_time));
+        battlecruiser.updateVelocityPosition(static_cast<float>(delta_time), collision_world);
         // -- Update battlecruiser camera
         battlecruiserCamera.update_input();
         // -- Update battlecruiser particles
         particles.update(active_camera->get_position(), static_cast<float>(delta_time));
 
-        /// -- Update bodies
-        planet_system.update(time_warp * (float) delta_time);
+        /// -- Update fleet
+        fleet.update(static_cast<float>(delta_time), collision_world);
 
         /// ---- ImGui
         // window.update_input already called ImGui::NewFrame()
@@ -192,8 +274,28 @@ int main() {
         } else {
             // not debug mode
             ImGui::SliderFloat("Time Warp", &time_warp, 0.0f, 10.0f, "%.2f x");
+            ImGui::Text("Picked (right click): %s", picked.c_str());
+            if (battlecruiser.getNearestBody() >= 0) {
+                ImGui::Text("Battlecruiser near body %d, clearance %.2f",
+                            battlecruiser.getNearestBody(),
+                            (double)battlecruiser.getNearestClearance());
+            }
             /// -- ImGui Body selection and controls
+            ImGui::Checkbox("Dynamic Reflections", &dynamic_reflections);
+            ImGui::SliderInt("Probe Faces per Frame", &probe_faces_per_frame, 1,
+                             EnvironmentProbe::NUM_FACES);
+            ImGui::Text("Probe %dx%d: %d faces, %.3f ms GPU",
+                        environment_probe.get_resolution(),
+                        environment_probe.get_resolution(),
+                        environment_probe.get_faces_rendered(),
+                        (double)probe_timer.get_ms());
+            ImGui::Checkbox("Occlusion Culling", &occlusion_culler.enabled);
+            ImGui::Text("Occlusion culled: %d of %d tested",
+                        occlusion_culler.get_num_culled(),
+                        occlusion_culler.get_num_tested());
             planet_system.imgui();
+            particles.imgui();
+            fleet.imgui();
 
             ImGui::Separator();
         }
@@ -202,12 +304,42 @@ int main() {
 
         //// ---- Rendering
 
+        reset_opengl_state();
+        frame_timer.begin();
+
+        /// -- Pass #0: Environment probe faces due this frame, seen from the
+        // battlecruiser. Counts towards the frame time the particle budget
+        // uses, the probe timer nests inside the frame timer.
+        if (!debug_mode && dynamic_reflections) {
+            const glm::vec3 probe_position = battlecruiser.getModelMatrix()[3];
+            const auto reset_probe_state = [&]() {
+                reset_opengl_state();
+                environment_probe.bind_for_writing();
+            };
+            probe_timer.begin();
+            environment_probe.update(
+                probe_position, probe_faces_per_frame,
+                [&](const glm::mat4 &view, const glm::mat4 &projection) {
+                    reset_probe_state();
+                    skybox.draw(view, projection);
+                    planet_system.draw(
+                        view, projection, probe_position,
+                        static_cast<float>(environment_probe.get_resolution()),
+                        reset_probe_state, true);
+                });
+            probe_timer.end();
+        }
+
         /// -- Set states and clear buffers
         reset_opengl_state();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         if (debug_mode) {
         } else {
+            occlusion_culler.begin_frame(
+                projection_matrix * active_camera->get_view_matrix(),
+                active_camera->get_position(), 0.1f);
+
             /// -- Pass #1: Render Skybox
             reset_opengl_state();
             skybox.draw(active_camera->get_view_matrix(), projection_matrix);
@@ -217,18 +349,35 @@ int main() {
             planet_system.draw(active_camera->get_view_matrix(),
                                projection_matrix, active_camera->get_position(),
                                static_cast<float>(HEIGHT_WINDOW),
-                               reset_opengl_state);
+                               reset_opengl_state, false, &occlusion_culler);
 
             /// -- Pass #4 and #5: Render Battlecruiser Mesh
             reset_opengl_state();
             battlecruiser.draw(
                 active_camera->get_view_matrix(), projection_matrix,
                 glm::vec3(10.0f, 10.0f, 10.0f), active_camera->get_position(),
-                skybox.getCubemapTexture());
+                dynamic_reflections ? environment_probe.get_texture()
+                                    : skybox.getCubemapTexture(),
+                &occlusion_culler);
+
+            /// -- Pass #4 and #5 for the fleet, instanced. The probe is seen
+            // from the battlecruiser, close enough for ships flying nearby.
+            reset_opengl_state();
+            fleet.draw(
+                active_camera->get_view_matrix(), projection_matrix,
+                glm::vec3(10.0f, 10.0f, 10.0f), active_camera->get_position(),
+                dynamic_reflections ? environment_probe.get_texture()
+                                    : skybox.getCubemapTexture());
 
             /// -- Pass #6: Render battlecruiser Particles
             reset_opengl_state();
-            particles.draw_stage(active_camera->get_view_matrix(), projection_matrix);
+            particles.draw_stage(active_camera->get_view_matrix(), projection_matrix,
+                                 glm::ivec2(WIDTH_WINDOW, HEIGHT_WINDOW), &occlusion_culler);
+        }
+
+        frame_timer.end();
+        if (frame_timer.has_measurement()) {
+            particles.set_frame_gpu_ms(frame_timer.get_ms());
         }
 
         //// ---- Swap buffers
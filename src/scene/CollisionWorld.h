@@ -0,0 +1,142 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "scene/bodies/Body.h"
+
+// A sphere near or inside the surface of a body
+struct Contact {
+    int body;          // index into the bodies given to CollisionWorld::update
+    glm::vec3 normal;  // from the body center through the sphere center
+    float clearance;   // sphere to surface along the normal, negative when penetrating
+};
+
+// Spheres (ships) against the bodies of the planet system.
+//
+// Broadphase is sort and sweep along x: update() sorts the bodies' bounding
+// spheres by their lower x bound once per frame, so a single query binary
+// searches for the few bodies whose x interval overlaps its own. Batches of
+// spheres are swept the other way round, each body binary searching the
+// spheres sorted by their lower x bound, which is O((bodies + spheres) log)
+// plus the overlapping pairs.
+//
+// Narrowphase samples the body's displaced surface (Body::get_surface_radius,
+// the CPU copy of the tessellation shader's height function) once, in the
+// direction of the sphere's center. That is exact for bodies without terrain
+// and good for spheres smaller than the terrain features, which ships are.
+//
+// Queries report every body whose surface is within `margin` of the sphere,
+// so the same pass serves collision (clearance < 0) and proximity.
+class CollisionWorld {
+   public:
+    // Takes the bodies' positions and bounding radii of this frame; call
+    // after the bodies moved. The bodies must outlive the queries.
+    void update(const std::vector<Body*>& bodies) {
+        colliders.clear();
+        bounding_spheres.clear();
+        max_body_radius = 0.0f;
+        for (size_t i = 0; i < bodies.size(); i++) {
+            glm::vec3 center = bodies[i]->getPosition();
+            float radius = bodies[i]->get_bounding_radius();
+            colliders.push_back({center.x - radius, center, radius, bodies[i], (int)i});
+            bounding_spheres.emplace_back(center, radius);
+            max_body_radius = std::max(max_body_radius, radius);
+        }
+        std::sort(colliders.begin(), colliders.end(),
+                  [](const Collider& a, const Collider& b) { return a.min_x < b.min_x; });
+    }
+
+    // Calls on_contact(const Contact&) for every body within `margin` of the
+    // sphere
+    template <typename F>
+    void query_sphere(const glm::vec3& center, float radius, float margin,
+                      F&& on_contact) const {
+        const float reach = radius + margin;
+        // a body can't reach further left than its lower bound plus its diameter
+        auto it = std::lower_bound(
+            colliders.begin(), colliders.end(),
+            center.x - reach - 2.0f * max_body_radius,
+            [](const Collider& c, float x) { return c.min_x < x; });
+        for (; it != colliders.end() && it->min_x <= center.x + reach; ++it) {
+            test(*it, center, radius, margin, on_contact);
+        }
+    }
+
+    // Calls on_contact(int sphere, const Contact&) for every sphere (xyz =
+    // center, w = radius) and body within `margin` of each other, grouped by
+    // body
+    template <typename F>
+    void query_spheres(std::span<const glm::vec4> spheres, float margin,
+                       F&& on_contact) {
+        sorted.clear();
+        float max_radius = 0.0f;
+        for (size_t i = 0; i < spheres.size(); i++) {
+            sorted.push_back({spheres[i].x - spheres[i].w, (int)i});
+            max_radius = std::max(max_radius, spheres[i].w);
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const SortedSphere& a, const SortedSphere& b) { return a.min_x < b.min_x; });
+
+        for (const Collider& collider : colliders) {
+            const float max_x = collider.center.x + collider.radius + margin;
+            auto it = std::lower_bound(
+                sorted.begin(), sorted.end(),
+                collider.min_x - margin - 2.0f * max_radius,
+                [](const SortedSphere& s, float x) { return s.min_x < x; });
+            for (; it != sorted.end() && it->min_x <= max_x; ++it) {
+                const glm::vec4& sphere = spheres[(size_t)it->index];
+                const int index = it->index;
+                test(collider, glm::vec3(sphere), sphere.w, margin,
+                     [&](const Contact& contact) { on_contact(index, contact); });
+            }
+        }
+    }
+
+    // xyz = center, w = bounding radius, in the order of update()'s bodies
+    const std::vector<glm::vec4>& get_bounding_spheres() const {
+        return bounding_spheres;
+    }
+
+   private:
+    struct Collider {
+        float min_x;  // sort key
+        glm::vec3 center;
+        float radius;  // bounding
+        const Body* body;
+        int index;
+    };
+    struct SortedSphere {
+        float min_x;
+        int index;
+    };
+
+    template <typename F>
+    static void test(const Collider& collider, const glm::vec3& center,
+                     float radius, float margin, F&& on_contact) {
+        const glm::vec3 offset = center - collider.center;
+        const float reach = collider.radius + radius + margin;
+        const float distance2 = glm::dot(offset, offset);
+        if (distance2 > reach * reach) return;
+
+        const float distance = glm::sqrt(distance2);
+        const glm::vec3 normal =
+            distance > 0.0f ? offset / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+        const float clearance =
+            distance - radius - collider.body->get_surface_radius(normal);
+        if (clearance <= margin) {
+            on_contact(Contact{collider.index, normal, clearance});
+        }
+    }
+
+    std::vector<Collider> colliders;  // sorted by min_x
+    std::vector<glm::vec4> bounding_spheres;
+    float max_body_radius = 0.0f;
+    std::vector<SortedSphere> sorted;  // scratch of query_spheres
+};
@@ -3,20 +3,28 @@
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
 #include <glad/glad.h>
-#include <stb/stb_image.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 DISABLE_WARNINGS_POP()
+#include <framework/image.h>
 #include <framework/shader.h>
 
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <optional>
 #include <vector>
 
+#include "core/KtxFile.h"
+#include "core/ThreadPool.h"
+#include "texture.h"
+
 class Skybox {
    public:
-    Skybox() {
+    // The faces are decoded in parallel on thread_pool
+    explicit Skybox(ThreadPool& thread_pool) {
         // Load cube-map
         std::vector<std::string> skyboxFaces = {
             RESOURCE_ROOT "resources/skybox/px.png",  // +X (right)
@@ -34,7 +42,12 @@ class Skybox {
                                RESOURCE_ROOT "shaders/skybox_frag.glsl")
                      .build();
 
-        _cubemapTexture = loadCubemap(skyboxFaces);
+        // prefer the block-compressed cube map made by
+        // TextureConverter --cubemap from the faces above, in that order
+        _cubemapTexture =
+            loadCompressedCubemap(RESOURCE_ROOT "resources/skybox/skybox.ktx");
+        if (_cubemapTexture == 0)
+            _cubemapTexture = loadCubemap(skyboxFaces, thread_pool);
 
         // Create VAO, VBO, and IBO for the skybox
         glGenVertexArrays(1, &_vao);
@@ -89,24 +102,70 @@ class Skybox {
     unsigned int getCubemapTexture() { return _cubemapTexture; }
 
    private:
-    unsigned int loadCubemap(const std::vector<std::string>& faces) {
+    // 0 when the file is missing, unreadable or in a format the driver
+    // doesn't support
+    unsigned int loadCompressedCubemap(const std::filesystem::path& path) {
+        if (!std::filesystem::exists(path)) return 0;
+
+        auto start = std::chrono::steady_clock::now();
+        const std::optional<KtxFile> ktx = read_ktx(path);
+        if (!ktx) return 0;
+        if (ktx->faces != 6 ||
+            !is_compressed_format_supported(ktx->internal_format)) {
+            std::cerr << path
+                      << " isn't a cube map in a supported compressed format"
+                      << std::endl;
+            return 0;
+        }
+
         unsigned int textureID;
         glGenTextures(1, &textureID);
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        upload_ktx(*ktx);
+        std::cout << "Compressed skybox loaded in "
+                  << std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count()
+                  << " ms" << std::endl;
+
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
+                        ktx->levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR
+                                               : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,
+                        GL_CLAMP_TO_EDGE);
+
+        return textureID;
+    }
 
-        int width, height, nrChannels;
-        for (unsigned int i = 0; i < faces.size(); i++) {
-            stbi_uc* data =
-                stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 3);
-            if (data) {
+    unsigned int loadCubemap(const std::vector<std::string>& faces,
+                             ThreadPool& thread_pool) {
+        auto start = std::chrono::steady_clock::now();
+        const std::vector<std::optional<Image>> images = decodeImages(
+            std::vector<std::filesystem::path>(faces.begin(), faces.end()),
+            thread_pool, 3);
+        std::cout << "Skybox faces decoded in "
+                  << std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count()
+                  << " ms" << std::endl;
+
+        // GL calls stay on this thread
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        for (unsigned int i = 0; i < images.size(); i++) {
+            if (images[i]) {
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,  // which face
-                             0, GL_RGB, width, height, 0, GL_RGB,
-                             GL_UNSIGNED_BYTE, data);
-                stbi_image_free(data);
+                             0, GL_RGB, images[i]->width, images[i]->height, 0,
+                             GL_RGB, GL_UNSIGNED_BYTE, images[i]->get_data());
             } else {
                 std::cerr << "Failed to load cubemap face: " << faces[i]
                           << std::endl;
-                stbi_image_free(data);
             }
         }
 
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <vector>
+
+// Node of the scene's transform hierarchy (ship, planet -> moon, ...).
+//
+// The world matrix is parent world * local, computed on first use and cached
+// until the local matrix of the node or of an ancestor changes, so any number
+// of readers per frame pay for one multiplication per node at most.
+// Changing a local matrix marks the node and its descendants dirty; a dirty
+// node's descendants are always dirty, so marking stops at the first node
+// already dirty.
+//
+// Nodes link to each other by address and so can't be copied or moved;
+// destroying one detaches it from its parent and children. Not thread safe:
+// read world matrices on one thread, or copy them out first.
+class Transform {
+   public:
+    Transform() = default;
+    explicit Transform(const glm::mat4& initial_local) : local(initial_local) {}
+
+    Transform(const Transform&) = delete;
+    Transform& operator=(const Transform&) = delete;
+
+    ~Transform() {
+        set_parent(nullptr);
+        for (Transform* child : children) {
+            child->parent = nullptr;
+            child->mark_dirty();
+        }
+    }
+
+    // nullptr makes this a root. The local matrix is kept, so the node moves
+    // with its new parent.
+    void set_parent(Transform* new_parent) {
+        if (new_parent == parent) return;
+        if (parent != nullptr) {
+            auto& siblings = parent->children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+        }
+        parent = new_parent;
+        if (parent != nullptr) parent->children.push_back(this);
+        mark_dirty();
+    }
+
+    // Setting the current value again keeps the cached world matrices
+    void set_local(const glm::mat4& new_local) {
+        if (new_local == local) return;
+        local = new_local;
+        mark_dirty();
+    }
+
+    // Replaces the translation of the local matrix only
+    void set_local_position(const glm::vec3& position) {
+        set_local(glm::mat4(local[0], local[1], local[2], glm::vec4(position, 1.0f)));
+    }
+
+    const glm::mat4& get_local() const { return local; }
+    Transform* get_parent() const { return parent; }
+
+    const glm::mat4& get_world() const {
+        if (dirty) {
+            world = parent != nullptr ? parent->get_world() * local : local;
+            dirty = false;
+        }
+        return world;
+    }
+
+    glm::vec3 get_world_position() const { return glm::vec3(get_world()[3]); }
+
+   private:
+    void mark_dirty() {
+        if (dirty) return;
+        dirty = true;
+        for (Transform* child : children) child->mark_dirty();
+    }
+
+    glm::mat4 local{1.0f};
+    mutable glm::mat4 world{1.0f};
+    mutable bool dirty = true;
+    Transform* parent = nullptr;
+    std::vector<Transform*> children;
+};
@@ -2,53 +2,14 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <cstdlib>
 #include <framework/shader.h>
-#include <framework/mesh.h>
 #include <random>
 #include <iostream>
+#include <limits>
 #include <glm/gtx/quaternion.hpp>
 
-Battlecruiser::Battlecruiser(Window& window): window(window) {
-    const std::vector<Mesh> meshes = loadMesh(RESOURCE_ROOT "resources/BattleCruiser.obj");
-    
-    for (const auto& mesh : meshes)
-    {
-        MeshGL m;
-
-        // Create VAO
-        glGenVertexArrays(1, &m.vao);
-        glBindVertexArray(m.vao);
-
-        // Create and upload vertex buffer
-        glGenBuffers(1, &m.vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
-        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
-
-        // Create and upload index buffer
-        glGenBuffers(1, &m.ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.triangles.size() * sizeof(glm::uvec3), mesh.triangles.data(), GL_STATIC_DRAW);
-
-        // Vertex attributes
-        glEnableVertexAttribArray(0); // position
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-
-        glEnableVertexAttribArray(1); // normal
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-
-        glEnableVertexAttribArray(2); //tex Coordinates
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-
-        glBindVertexArray(0);
-
-        m.indexCount = mesh.triangles.size() * 3;
-        m.materialName = mesh.material.name;
-
-        std::cout << "Mesh detected: " << m.materialName << std::endl;
-        std::cout << "Mesh vertices: " << mesh.vertices.size()
-            << " triangles: " << mesh.triangles.size() << std::endl;
-
-        meshGLs.push_back(m);
-    }
+Battlecruiser::Battlecruiser(Window& appWindow, const Config& config)
+    : window(appWindow), proximityMargin(config.collision_proximity_margin), mesh(config) {
+    transform.set_local(computeLocalMatrix());
 
     mainShader =
         ShaderBuilder()
@@ -70,17 +31,20 @@ void Battlecruiser::draw(const glm::mat4& view,
     const glm::mat4& projection,
     const glm::vec3& lightPos,
     const glm::vec3& cameraPos,
-    unsigned int cubemapTexture)
+    unsigned int cubemapTexture,
+    OcclusionCuller* occlusion)
 {
-    // --- Setup once per frame ---
-    LightParticle thruster = {
-        glm::vec3(0.0f, 4.0f, -50.0f),
-        glm::vec3(0.0f, 0.0f, -1.0f),
-        glm::vec3(1.0f, 0.5f, 0.1f),
-        glm::radians(80.0f),
-        45.0f,
-        4.5f
-    };
+    // Test before drawing anything, against the planets drawn so far
+    const std::vector<uint8_t>* opaqueVisible = nullptr;
+    const std::vector<uint8_t>* glassVisible = nullptr;
+    if (occlusion != nullptr) {
+        std::vector<uint8_t>& opaque = visibleSubMeshes[static_cast<int>(MaterialPass::Opaque)];
+        std::vector<uint8_t>& glass = visibleSubMeshes[static_cast<int>(MaterialPass::Glass)];
+        mesh.testOcclusion(MaterialPass::Opaque, getModelMatrix(), *occlusion, opaque);
+        mesh.testOcclusion(MaterialPass::Glass, getModelMatrix(), *occlusion, glass);
+        opaqueVisible = &opaque;
+        glassVisible = &glass;
+    }
 
     // Disable face culling to render inside the windows
     glDisable(GL_CULL_FACE); 
@@ -92,22 +56,9 @@ void Battlecruiser::draw(const glm::mat4& view,
                        glm::value_ptr(getModelMatrix()));
     glUniformMatrix4fv(mainShader.getUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(mainShader.getUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform3fv(mainShader.getUniformLocation("lightPos"), 1, glm::value_ptr(lightPos));
-
-    glUniform3fv(mainShader.getUniformLocation("thrusterLightPos"), 1, glm::value_ptr(thruster.pos));
-    glUniform3fv(mainShader.getUniformLocation("thrusterLightDir"), 1, glm::value_ptr(thruster.dir));
-    glUniform3fv(mainShader.getUniformLocation("thrusterLightColor"), 1, glm::value_ptr(thruster.color));
-    glUniform1f(mainShader.getUniformLocation("thrusterThresholdLight"), thruster.thresholdLight);
-    glUniform1f(mainShader.getUniformLocation("thrusterLightIntensity"), thruster.intensity);
-    glUniform1f(mainShader.getUniformLocation("thrusterLightAngle"), thruster.angle);
-
-    // Draw all opaque meshes that use the main shader
-    for (const auto& m : meshGLs) {
-        if (m.materialName == "Steel_-_Satin") {
-            glBindVertexArray(m.vao);
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m.indexCount), GL_UNSIGNED_INT, nullptr);
-        }
-    }
+    setBattlecruiserLighting(mainShader, lightPos);
+
+    mesh.drawPass(MaterialPass::Opaque, 0, opaqueVisible);
 
     // --- Pass 2: reflective meshes ---
     // Skip depth testing to avoid artifacts inside the windows
@@ -124,15 +75,30 @@ void Battlecruiser::draw(const glm::mat4& view,
     glUniformMatrix4fv(reflectiveShader.getUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(reflectiveShader.getUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    for (const auto& m : meshGLs) {
-        if (m.materialName == "Window-Cabin-Material") {
-            glBindVertexArray(m.vao);
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m.indexCount), GL_UNSIGNED_INT, nullptr);
-        }
-    }
+    mesh.drawPass(MaterialPass::Glass, 0, glassVisible);
+}
+
+void setBattlecruiserLighting(const Shader& shader, const glm::vec3& lightPos) {
+    LightParticle thruster = {
+        glm::vec3(0.0f, 4.0f, -50.0f),
+        glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(1.0f, 0.5f, 0.1f),
+        glm::radians(80.0f),
+        45.0f,
+        4.5f
+    };
+
+    glUniform3fv(shader.getUniformLocation("lightPos"), 1, glm::value_ptr(lightPos));
+
+    glUniform3fv(shader.getUniformLocation("thrusterLightPos"), 1, glm::value_ptr(thruster.pos));
+    glUniform3fv(shader.getUniformLocation("thrusterLightDir"), 1, glm::value_ptr(thruster.dir));
+    glUniform3fv(shader.getUniformLocation("thrusterLightColor"), 1, glm::value_ptr(thruster.color));
+    glUniform1f(shader.getUniformLocation("thrusterThresholdLight"), thruster.thresholdLight);
+    glUniform1f(shader.getUniformLocation("thrusterLightIntensity"), thruster.intensity);
+    glUniform1f(shader.getUniformLocation("thrusterLightAngle"), thruster.angle);
 }
 
-void Battlecruiser::updateVelocityPosition(float deltaTime) {
+void Battlecruiser::updateVelocityPosition(float deltaTime, const CollisionWorld& collisions) {
     static float currentBankAngle = 0.0f;
 
     float initialSpeed = glm::length(velocity);
@@ -192,6 +158,35 @@ void Battlecruiser::updateVelocityPosition(float deltaTime) {
     glm::vec3 bankedUp = glm::normalize(glm::vec3(rollMatrix * glm::vec4(glm::vec3(0.0f, 1.0f, 0.0f), 0.0f)));
 
     upVector = bankedUp;
+
+    nearestBody = -1;
+    nearestClearance = std::numeric_limits<float>::infinity();
+    const glm::mat4 model = computeLocalMatrix();
+    const glm::vec3 hullCenter = glm::vec3(model * glm::vec4(mesh.getBoundsCenter(), 1.0f));
+    const float hullRadius = mesh.getBoundsRadius() * glm::length(glm::vec3(model[0]));
+    collisions.query_sphere(hullCenter, hullRadius, proximityMargin,
+                            [this](const Contact& contact) { onContact(contact); });
+
+    transform.set_local(computeLocalMatrix());
+}
+
+void Battlecruiser::onContact(const Contact& contact) {
+    if (contact.clearance < nearestClearance) {
+        nearestBody = contact.body;
+        nearestClearance = contact.clearance;
+    }
+    if (contact.clearance >= 0.0f) return;
+
+    position -= contact.normal * contact.clearance;
+    const float into = glm::dot(velocity, contact.normal);
+    if (into < 0.0f) {
+        const glm::vec3 slide = velocity - contact.normal * into;
+        // head-on there's no direction to slide in, the push out alone holds
+        // the ship at the surface until it's steered away
+        if (glm::length(slide) > 1e-3f) {
+            velocity = glm::normalize(slide) * glm::length(velocity);
+        }
+    }
 }
 
 
@@ -199,7 +194,7 @@ std::vector<glm::vec3> Battlecruiser::getRelativePositionThrusters() {
     return relativePositionThrusters;
 }
 
-glm::mat4 Battlecruiser::getModelMatrix() {
+glm::mat4 Battlecruiser::computeLocalMatrix() {
     glm::mat4 translationMat = glm::translate(glm::mat4(1.0f), position);
 
     glm::vec3 dirV = getDirectionVector();
@@ -229,11 +224,4 @@ glm::vec3 Battlecruiser::getUpVector() {
 }
 
 
-Battlecruiser::~Battlecruiser() {
-    for (const MeshGL& m : meshGLs)
-    {
-        glDeleteBuffers(1, &m.vbo);
-        glDeleteBuffers(1, &m.ibo);
-        glDeleteVertexArrays(1, &m.vao);
-    }
-}
\ No newline at end of file
+Battlecruiser::~Battlecruiser() = default;
\ No newline at end of file
@@ -3,9 +3,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include <framework/shader.h>
-#include <framework/mesh.h>
 #include <framework/window.h>
 
+#include "core/config.h"
+#include "scene/CollisionWorld.h"
+#include "scene/Transform.h"
+#include "BattlecruiserMesh.h"
+
 struct LightParticle {
     glm::vec3 pos;
     glm::vec3 dir;
@@ -15,26 +19,45 @@ struct LightParticle {
     float intensity;
 };
 
+// Sets the light and thruster light uniforms of the opaque battlecruiser shader
+void setBattlecruiserLighting(const Shader& shader, const glm::vec3& lightPos);
+
 class Battlecruiser {
     Window& window;
 public:
-    Battlecruiser(Window& window);
+    // Materials are assigned to passes by config.battlecruiser_material_passes
+    Battlecruiser(Window& window, const Config& config);
     ~Battlecruiser();
 
     void draw(const glm::mat4& view,
         const glm::mat4& projection,
         const glm::vec3& lightPos,
         const glm::vec3& cameraPos,
-        unsigned int cubemapTexture);
+        unsigned int cubemapTexture,
+        OcclusionCuller* occlusion = nullptr);
 
-    void updateVelocityPosition(float deltaTime);
+    // Flies the ship from the keyboard and keeps it out of the bodies
+    void updateVelocityPosition(float deltaTime, const CollisionWorld& collisions);
 
     std::vector<glm::vec3> getRelativePositionThrusters();
-    glm::mat4 getModelMatrix();
+    // Cached, only rebuilt when the ship moved
+    const glm::mat4& getModelMatrix() const { return transform.get_world(); }
+    // Node to attach things following the ship to
+    Transform& getTransform() { return transform; }
 
     glm::vec3 getDirectionVector();
     glm::vec3 getUpVector();
 
+    // Model shared with the fleet
+    const BattlecruiserMesh& getMesh() const { return mesh; }
+    // Closest hit of a world-space ray with the ship, shortens ray.t on a hit
+    bool pick(Ray& ray) const { return mesh.intersect(ray, getModelMatrix()); }
+
+    // Closest body within the proximity margin after the last update, or -1
+    int getNearestBody() const { return nearestBody; }
+    // Hull to surface distance of that body
+    float getNearestClearance() const { return nearestClearance; }
+
 private:
     glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec3 velocity = glm::vec3(0.0f, 0.0f, 1.0f);
@@ -42,6 +65,7 @@ private:
     glm::vec3 upVector = glm::vec3(0.0f, 1.0f, 0.0f);
 
     glm::mat4 modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.05f));
+    Transform transform;
 
     std::vector<glm::vec3> relativePositionThrusters = {
         glm::vec3(0.0f, -0.5f, -22.0f),
@@ -50,8 +74,21 @@ private:
         glm::vec3(-4.5f, 4.0f, -22.0f)
     };
 
+    // Local matrix from position, heading and bank
+    glm::mat4 computeLocalMatrix();
+    // Contact callback: pushes the hull's bounding sphere back onto the
+    // surface and drops the velocity into it, so the ship slides along
+    void onContact(const Contact& contact);
+
+    float proximityMargin;
+    int nearestBody = -1;
+    float nearestClearance = 0.0f;
+
+    // Sub-meshes that passed the last occlusion test, per pass
+    std::vector<uint8_t> visibleSubMeshes[MATERIAL_PASS_COUNT];
+
     Shader mainShader;
     Shader reflectiveShader;
 
-    std::vector<MeshGL> meshGLs;
+    BattlecruiserMesh mesh;
 };
\ No newline at end of file
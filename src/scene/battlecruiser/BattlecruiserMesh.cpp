@@ -0,0 +1,287 @@
+#include "BattlecruiserMesh.h"
+#include <glm/gtc/matrix_inverse.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+
+// Grid cell of every LOD, as a fraction of the model's bounding box diagonal
+static constexpr float LOD_CELL_SIZES[BattlecruiserMesh::LOD_COUNT] = {0.0f, 1.0f / 100.0f, 1.0f / 40.0f};
+
+static std::optional<MaterialPass> parseMaterialPass(const std::string& pass) {
+    if (pass == "opaque") return MaterialPass::Opaque;
+    if (pass == "glass") return MaterialPass::Glass;
+    return std::nullopt;
+}
+
+static MeshGL uploadMesh(const Mesh& mesh) {
+    MeshGL m;
+
+    // Create VAO
+    glGenVertexArrays(1, &m.vao);
+    glBindVertexArray(m.vao);
+
+    // Create and upload vertex buffer
+    glGenBuffers(1, &m.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.vertices.size() * sizeof(Vertex)), mesh.vertices.data(), GL_STATIC_DRAW);
+
+    // Create and upload index buffer
+    glGenBuffers(1, &m.ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.triangles.size() * sizeof(glm::uvec3)), mesh.triangles.data(), GL_STATIC_DRAW);
+
+    // Vertex attributes
+    glEnableVertexAttribArray(0); // position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+
+    glEnableVertexAttribArray(1); // normal
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+
+    glEnableVertexAttribArray(2); //tex Coordinates
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+
+    // Per-instance model matrix, one column per location. Only enabled for
+    // instanced draws, with the pointers set per draw.
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribDivisor(BattlecruiserMesh::INSTANCE_MODEL_LOCATION + column, 1);
+    }
+
+    glBindVertexArray(0);
+
+    m.indexCount = mesh.triangles.size() * 3;
+    m.materialName = mesh.material.name;
+    return m;
+}
+
+BattlecruiserMesh::BattlecruiserMesh(const Config& config) {
+    const std::vector<Mesh> meshes = loadMesh(RESOURCE_ROOT "resources/BattleCruiser.obj");
+
+    glm::vec3 lower(std::numeric_limits<float>::max());
+    glm::vec3 upper(std::numeric_limits<float>::lowest());
+    for (const Mesh& mesh : meshes) {
+        for (const Vertex& v : mesh.vertices) {
+            lower = glm::min(lower, v.position);
+            upper = glm::max(upper, v.position);
+        }
+    }
+    boundsCenter = 0.5f * (lower + upper);
+    boundsRadius = 0.5f * glm::length(upper - lower);
+    const float diagonal = glm::length(upper - lower);
+
+    bvh = BVH(meshes, BVHBuildSettings{.parallel = true});
+
+    for (int lod = 0; lod < LOD_COUNT; lod++) {
+        for (const Mesh& mesh : meshes) {
+            glm::vec3 meshLower(std::numeric_limits<float>::max());
+            glm::vec3 meshUpper(std::numeric_limits<float>::lowest());
+            for (const Vertex& v : mesh.vertices) {
+                meshLower = glm::min(meshLower, v.position);
+                meshUpper = glm::max(meshUpper, v.position);
+            }
+
+            MeshGL m = lod == 0 ? uploadMesh(mesh)
+                                : uploadMesh(simplifyMesh(mesh, LOD_CELL_SIZES[lod] * diagonal));
+            m.materialId = resolveMaterial(m.materialName, config);
+            triangleCounts[static_cast<size_t>(lod)] += m.indexCount / 3;
+
+            if (lod == 0) {
+                std::cout << "Mesh detected: " << m.materialName << std::endl;
+                std::cout << "Mesh vertices: " << mesh.vertices.size()
+                    << " triangles: " << mesh.triangles.size() << std::endl;
+            }
+
+            MaterialPass pass = materialPasses[m.materialId];
+            drawLists[static_cast<size_t>(lod)][static_cast<size_t>(pass)].push_back(
+                {m.materialId, m.vao, static_cast<GLsizei>(m.indexCount), meshLower, meshUpper});
+            meshGLs.push_back(m);
+        }
+    }
+
+    // Group draws by material so state changes stay together
+    for (auto& passes : drawLists) {
+        for (std::vector<DrawItem>& list : passes) {
+            std::sort(list.begin(), list.end(), [](const DrawItem& a, const DrawItem& b) {
+                return a.materialId != b.materialId ? a.materialId < b.materialId : a.vao < b.vao;
+            });
+        }
+    }
+}
+
+BattlecruiserMesh::~BattlecruiserMesh() {
+    for (const MeshGL& m : meshGLs)
+    {
+        glDeleteBuffers(1, &m.vbo);
+        glDeleteBuffers(1, &m.ibo);
+        glDeleteVertexArrays(1, &m.vao);
+    }
+}
+
+void BattlecruiserMesh::drawPass(MaterialPass pass, int lod, const std::vector<uint8_t>* visible) const {
+    const std::vector<DrawItem>& list = drawLists[static_cast<size_t>(lod)][static_cast<size_t>(pass)];
+    for (size_t i = 0; i < list.size(); i++) {
+        if (visible != nullptr && !(*visible)[i]) continue;
+        const DrawItem& item = list[i];
+        glBindVertexArray(item.vao);
+        glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, nullptr);
+    }
+    glBindVertexArray(0);
+}
+
+void BattlecruiserMesh::testOcclusion(MaterialPass pass, const glm::mat4& model, OcclusionCuller& occlusion,
+                                      std::vector<uint8_t>& visible) const {
+    const std::vector<DrawItem>& list = drawLists[0][static_cast<size_t>(pass)];
+    visible.resize(list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        visible[i] = occlusion.test_box(&list[i], model, list[i].boundsMin, list[i].boundsMax);
+    }
+}
+
+int BattlecruiserMesh::drawPassInstanced(MaterialPass pass, int lod, GLuint instanceBuffer,
+                                         size_t offset, int count) const {
+    const std::vector<DrawItem>& list = drawLists[static_cast<size_t>(lod)][static_cast<size_t>(pass)];
+    if (count <= 0 || list.empty()) return 0;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (const DrawItem& item : list) {
+        glBindVertexArray(item.vao);
+        // no base instance in GL 4.1, so the pointers carry the offset
+        for (GLuint column = 0; column < 4; column++) {
+            GLuint location = INSTANCE_MODEL_LOCATION + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  (void*)(offset + column * sizeof(glm::vec4)));
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, nullptr, count);
+        for (GLuint column = 0; column < 4; column++) {
+            glDisableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+        }
+    }
+    glBindVertexArray(0);
+    return static_cast<int>(list.size());
+}
+
+bool BattlecruiserMesh::intersect(Ray& ray, const glm::mat4& model) const {
+    // cheap rejection against the bounding sphere first
+    Ray sphereRay = ray;
+    const glm::vec3 center = glm::vec3(model * glm::vec4(boundsCenter, 1.0f));
+    const float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+                                  glm::length(glm::vec3(model[2]))});
+    if (!intersectRayWithSphere(sphereRay, center, boundsRadius * scale)) return false;
+
+    // An unnormalized direction keeps t the same in model space
+    const glm::mat4 inverse = glm::affineInverse(model);
+    Ray local;
+    local.origin = glm::vec3(inverse * glm::vec4(ray.origin, 1.0f));
+    local.direction = glm::vec3(inverse * glm::vec4(ray.direction, 0.0f));
+    local.t = ray.t;
+    if (!bvh.intersect(local)) return false;
+    ray.t = local.t;
+    return true;
+}
+
+// Returns the id of the material, adding it to the table on first use
+uint32_t BattlecruiserMesh::resolveMaterial(const std::string& name, const Config& config) {
+    auto known = std::find(materialNames.begin(), materialNames.end(), name);
+    if (known != materialNames.end()) {
+        return static_cast<uint32_t>(known - materialNames.begin());
+    }
+
+    std::optional<MaterialPass> defaultPass = parseMaterialPass(config.battlecruiser_default_pass);
+    if (!defaultPass) {
+        std::cerr << "Unknown default material pass \"" << config.battlecruiser_default_pass
+                  << "\", using opaque" << std::endl;
+        defaultPass = MaterialPass::Opaque;
+    }
+
+    MaterialPass pass = *defaultPass;
+    auto assigned = std::find_if(config.battlecruiser_material_passes.begin(),
+                                 config.battlecruiser_material_passes.end(),
+                                 [&](const auto& entry) { return entry.first == name; });
+    if (assigned == config.battlecruiser_material_passes.end()) {
+        std::cerr << "Material \"" << name << "\" has no pass assigned, using the default pass"
+                  << std::endl;
+    } else if (std::optional<MaterialPass> configured = parseMaterialPass(assigned->second)) {
+        pass = *configured;
+    } else {
+        std::cerr << "Unknown pass \"" << assigned->second << "\" for material \"" << name
+                  << "\", using the default pass" << std::endl;
+    }
+
+    materialNames.push_back(name);
+    materialPasses.push_back(pass);
+    return static_cast<uint32_t>(materialNames.size() - 1);
+}
+
+void benchmarkBattlecruiserBVH(std::ostream& out) {
+    const std::vector<Mesh> meshes = loadMesh(RESOURCE_ROOT "resources/BattleCruiser.obj");
+    size_t triangles = 0;
+    for (const Mesh& mesh : meshes) triangles += mesh.triangles.size();
+    out << "Battlecruiser BVH (" << triangles << " triangles)\n";
+
+    auto msPerBuild = [&](bool parallel) {
+        const int iterations = 10;
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) BVH bvh(meshes, BVHBuildSettings{.parallel = parallel});
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+               iterations;
+    };
+    out << "  build, 1 thread:    " << msPerBuild(false) << " ms\n";
+    out << "  build, parallel:    " << msPerBuild(true) << " ms\n";
+
+    const BVH bvh(meshes, BVHBuildSettings{.parallel = true});
+    out << "  nodes: " << bvh.nodeCount() << "\n";
+
+    // Rays from a sphere around the model towards random points inside it
+    const glm::vec3 lower = bvh.boundsMin(), upper = bvh.boundsMax();
+    const glm::vec3 center = 0.5f * (lower + upper);
+    const float radius = glm::length(upper - lower);
+    std::mt19937 mt(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> inside(0.0f, 1.0f);
+    std::vector<Ray> rays(200000);
+    for (Ray& ray : rays) {
+        glm::vec3 onSphere;
+        do {
+            onSphere = glm::vec3(unit(mt), unit(mt), unit(mt));
+        } while (glm::dot(onSphere, onSphere) > 1.0f || glm::dot(onSphere, onSphere) < 1e-4f);
+        ray.origin = center + radius * glm::normalize(onSphere);
+        glm::vec3 target = lower + (upper - lower) * glm::vec3(inside(mt), inside(mt), inside(mt));
+        ray.direction = glm::normalize(target - ray.origin);
+    }
+
+    auto queriesPerSecond = [&](auto&& query) {
+        int hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Ray& ray : rays) hits += query(ray) ? 1 : 0;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(static_cast<double>(rays.size()) / seconds, hits);
+    };
+    auto [closestRate, closestHits] = queriesPerSecond([&](Ray ray) { return bvh.intersect(ray); });
+    out << "  closest hit: " << closestRate / 1e6 << " M rays/s (" << closestHits << " of " << rays.size()
+        << " hit)\n";
+    auto [anyRate, anyHits] = queriesPerSecond([&](const Ray& ray) { return bvh.intersectAny(ray); });
+    out << "  any hit:     " << anyRate / 1e6 << " M rays/s (" << anyHits << " hit)\n";
+
+    // Brute force on a few rays, to check the hits and for scale: a BVH
+    // with one leaf per mesh tests every triangle
+    std::vector<BVH> leaves;
+    for (const Mesh& mesh : meshes) {
+        leaves.emplace_back(std::span<const Mesh>(&mesh, 1), BVHBuildSettings{.maxLeafTriangles = 65535});
+    }
+    const size_t checked = 200;
+    int mismatches = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < checked; r++) {
+        Ray brute = rays[r];
+        for (const BVH& leaf : leaves) leaf.intersect(brute);
+        Ray accelerated = rays[r];
+        bvh.intersect(accelerated);
+        if (std::abs(brute.t - accelerated.t) > 1e-4f * std::max(1.0f, brute.t)) mismatches++;
+    }
+    double bruteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    out << "  brute force: " << checked / bruteSeconds / 1e3 << " k rays/s, " << mismatches
+        << " mismatches with the BVH\n";
+}
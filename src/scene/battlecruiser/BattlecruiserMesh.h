@@ -0,0 +1,85 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <framework/bvh.h>
+#include <framework/mesh.h>
+#include <framework/ray.h>
+
+#include "core/OcclusionCuller.h"
+#include "core/config.h"
+
+// Render passes of the battlecruiser, drawn in this order
+enum class MaterialPass { Opaque, Glass };
+constexpr int MATERIAL_PASS_COUNT = 2;
+
+// GPU resources of the battlecruiser model, shared by every ship drawing it:
+// the sub-meshes at each level of detail, the material table and the draw
+// list of every pass. Per-ship state lives in Battlecruiser and Fleet.
+class BattlecruiserMesh {
+public:
+    // LOD 0 is the full model, the others are vertex-clustered versions
+    static constexpr int LOD_COUNT = 3;
+    // Instanced draws read a mat4 model matrix from these attribute locations
+    static constexpr GLuint INSTANCE_MODEL_LOCATION = 3;  // 3 to 6
+
+    // Materials are assigned to passes by config.battlecruiser_material_passes
+    explicit BattlecruiserMesh(const Config& config);
+    ~BattlecruiserMesh();
+
+    BattlecruiserMesh(const BattlecruiserMesh&) = delete;
+    BattlecruiserMesh& operator=(const BattlecruiserMesh&) = delete;
+
+    // Draws the sub-meshes of the pass with the bound shader, only those set
+    // in `visible` when given (see testOcclusion)
+    void drawPass(MaterialPass pass, int lod = 0, const std::vector<uint8_t>* visible = nullptr) const;
+    // Occlusion tests the bounding box of every LOD 0 sub-mesh of the pass,
+    // for a ship drawn with `model`. Fills `visible` for drawPass at LOD 0.
+    // Binds the culler's shader.
+    void testOcclusion(MaterialPass pass, const glm::mat4& model, OcclusionCuller& occlusion,
+                       std::vector<uint8_t>& visible) const;
+    // Draws `count` instances, their model matrices read from `instanceBuffer`
+    // starting at byte `offset`. Returns the number of draw calls.
+    int drawPassInstanced(MaterialPass pass, int lod, GLuint instanceBuffer, size_t offset, int count) const;
+
+    // Bounding sphere in model space
+    glm::vec3 getBoundsCenter() const { return boundsCenter; }
+    float getBoundsRadius() const { return boundsRadius; }
+    size_t getTriangleCount(int lod) const { return triangleCounts[static_cast<size_t>(lod)]; }
+
+    // Full-detail triangles in model space, for ray queries and collision
+    const BVH& getBVH() const { return bvh; }
+    // Closest hit of a world-space ray with a ship drawn with `model`; on a
+    // hit shortens ray.t like BVH::intersect
+    bool intersect(Ray& ray, const glm::mat4& model) const;
+
+private:
+    uint32_t resolveMaterial(const std::string& name, const Config& config);
+
+    std::vector<MeshGL> meshGLs;  // all LODs
+
+    // Material table resolved at load time, indexed by MeshGL::materialId
+    std::vector<std::string> materialNames;
+    std::vector<MaterialPass> materialPasses;
+
+    // Sub-meshes per LOD and pass, sorted by material then VAO
+    struct DrawItem {
+        uint32_t materialId;
+        GLuint vao;
+        GLsizei indexCount;
+        glm::vec3 boundsMin;  // model space, of the full-detail sub-mesh
+        glm::vec3 boundsMax;
+    };
+    std::array<std::array<std::vector<DrawItem>, MATERIAL_PASS_COUNT>, LOD_COUNT> drawLists;
+
+    BVH bvh;
+    glm::vec3 boundsCenter{0.0f};
+    float boundsRadius = 0.0f;
+    std::array<size_t, LOD_COUNT> triangleCounts{};
+};
+
+// Headless BVH build time and ray queries per second on the battlecruiser model
+void benchmarkBattlecruiserBVH(std::ostream& out);
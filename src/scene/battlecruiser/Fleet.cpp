@@ -0,0 +1,241 @@
+#include "Fleet.h"
+#include "Battlecruiser.h"
+#include "core/Frustum.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <framework/disable_all_warnings.h>
+
+DISABLE_WARNINGS_PUSH()
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+
+// Same scale as the player's battlecruiser
+static constexpr float SHIP_SCALE = 0.05f;
+
+static float elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+Fleet::Fleet(const BattlecruiserMesh& mesh, const Config& config, ThreadPool& threadPool)
+    : _mesh(mesh),
+      _threadPool(threadPool),
+      _simulate(config.fleet_simulate),
+      _spacing(config.fleet_spacing),
+      _center(config.fleet_center),
+      _lodThresholds(config.fleet_lod_thresholds),
+      _instanceRing(GL_ARRAY_BUFFER, static_cast<size_t>(std::max(config.fleet_count, 1)) * sizeof(glm::mat4)) {
+    _instanceRing.set_mode(UploadRing::Mode::Orphan);
+    _simulation.params.neighborRadius = config.fleet_neighbor_radius;
+    _simulation.params.maxSpeed = config.fleet_max_speed;
+    setShipCount(config.fleet_count);
+
+    _mainShader =
+        ShaderBuilder()
+            .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                        "shaders/battlecruiser/fleet_vert.glsl")
+            .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
+                        "shaders/battlecruiser/shader_frag.glsl")
+            .build();
+    _reflectiveShader =
+        ShaderBuilder()
+            .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                        "shaders/battlecruiser/fleet_vert.glsl")
+            .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
+                        "shaders/battlecruiser/glass_shader_frag.glsl")
+            .build();
+}
+
+void Fleet::setShipCount(int count) {
+    _transforms.resize(static_cast<size_t>(std::max(count, 0)));
+    buildFormation();
+}
+
+// Cube of ships around _center, all facing +z. Restarts the simulation.
+void Fleet::buildFormation() {
+    const int count = static_cast<int>(_transforms.size());
+    const int side = std::max(1, static_cast<int>(std::ceil(std::cbrt(static_cast<float>(count)))));
+    const float half = 0.5f * static_cast<float>(side - 1);
+
+    std::vector<glm::vec3> positions(_transforms.size());
+    for (int i = 0; i < count; i++) {
+        glm::vec3 cell(static_cast<float>(i % side), static_cast<float>(i / (side * side)),
+                       static_cast<float>((i / side) % side));
+        const size_t ship = static_cast<size_t>(i);
+        positions[ship] = _center + (cell - half) * _spacing;
+        _transforms[ship] = glm::scale(glm::translate(glm::mat4(1.0f), positions[ship]), glm::vec3(SHIP_SCALE));
+    }
+
+    _simulation.home = _center;
+    _simulation.params.boundsRadius = std::max(_spacing * static_cast<float>(side), _simulation.params.neighborRadius);
+    const glm::vec3 velocity(0.0f, 0.0f, _simulation.params.minSpeed);
+    _simulation.reset(positions, std::vector<glm::vec3>(positions.size(), velocity));
+}
+
+void Fleet::update(float dt, CollisionWorld& collisions) {
+    if (!_simulate || dt <= 0.0f) return;
+
+    auto start = std::chrono::steady_clock::now();
+    // long frames (window dragged, breakpoints) would make ships jump through each other
+    _simulation.tick(std::min(dt, 0.1f), collisions.get_bounding_spheres(), _threadPool);
+    const float shipRadius = (glm::length(_mesh.getBoundsCenter()) + _mesh.getBoundsRadius()) * SHIP_SCALE;
+    _contacts = _simulation.resolveContacts(collisions, shipRadius);
+    _simulation.writeTransforms(_transforms, SHIP_SCALE, _threadPool);
+    _simulationMs = elapsedMs(start);
+}
+
+void Fleet::cull(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
+    auto start = std::chrono::steady_clock::now();
+
+    const Frustum frustum(projection * view);
+
+    // Projected radius as a fraction of the screen height is radius / distance * projection[1][1] / 2
+    const float projectionScale = 0.5f * projection[1][1];
+    const glm::vec4 boundsCenter(_mesh.getBoundsCenter(), 1.0f);
+
+    _shipLods.clear();
+    std::array<int, BattlecruiserMesh::LOD_COUNT> lodCounts{};
+    _visibleShips.clear();
+
+    for (size_t i = 0; i < _transforms.size(); i++) {
+        const glm::mat4& model = _transforms[i];
+        const glm::vec3 center = glm::vec3(model * boundsCenter);
+        const float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+                                      glm::length(glm::vec3(model[2]))});
+        const float radius = _mesh.getBoundsRadius() * scale;
+
+        if (_cullingEnabled && !frustum.intersects_sphere(center, radius)) {
+            continue;
+        }
+
+        int lod = _forcedLod;
+        if (lod < 0) {
+            const float distance = std::max(glm::length(center - cameraPos), 1e-4f);
+            const float projectedSize = radius / distance * projectionScale;
+            lod = projectedSize >= _lodThresholds.x ? 0 : projectedSize >= _lodThresholds.y ? 1 : 2;
+        }
+        _visibleShips.push_back(static_cast<int>(i));
+        _shipLods.push_back(static_cast<uint8_t>(lod));
+        lodCounts[static_cast<size_t>(lod)]++;
+    }
+
+    // Counting sort by LOD so every LOD is one contiguous instance range
+    _lodOffsets[0] = 0;
+    for (size_t lod = 0; lod < lodCounts.size(); lod++) {
+        _lodOffsets[lod + 1] = _lodOffsets[lod] + lodCounts[lod];
+    }
+    std::array<int, BattlecruiserMesh::LOD_COUNT> cursor;
+    std::copy(_lodOffsets.begin(), _lodOffsets.end() - 1, cursor.begin());
+    _visible.resize(_visibleShips.size());
+    for (size_t v = 0; v < _visibleShips.size(); v++) {
+        _visible[static_cast<size_t>(cursor[_shipLods[v]]++)] = _transforms[static_cast<size_t>(_visibleShips[v])];
+    }
+
+    _cullMs = elapsedMs(start);
+}
+
+int Fleet::pick(Ray& ray) const {
+    int picked = -1;
+    for (size_t i = 0; i < _transforms.size(); i++) {
+        if (_mesh.intersect(ray, _transforms[i])) picked = static_cast<int>(i);
+    }
+    return picked;
+}
+
+void Fleet::draw(const glm::mat4& view,
+    const glm::mat4& projection,
+    const glm::vec3& lightPos,
+    const glm::vec3& cameraPos,
+    unsigned int cubemapTexture)
+{
+    cull(view, projection, cameraPos);
+    _drawCalls = 0;
+    _trianglesDrawn = 0;
+    if (_visible.empty()) return;
+
+    const size_t base = _instanceRing.upload(_visible.data(), _visible.size() * sizeof(glm::mat4));
+    const GLuint buffer = _instanceRing.get_buffer();
+
+    auto drawLods = [&](MaterialPass pass) {
+        for (int lod = 0; lod < BattlecruiserMesh::LOD_COUNT; lod++) {
+            const int first = _lodOffsets[static_cast<size_t>(lod)];
+            const int count = _lodOffsets[static_cast<size_t>(lod) + 1] - first;
+            _drawCalls += _mesh.drawPassInstanced(pass, lod, buffer,
+                                                  base + static_cast<size_t>(first) * sizeof(glm::mat4), count);
+        }
+    };
+
+    // Same state as Battlecruiser::draw
+    glDisable(GL_CULL_FACE);
+
+    // --- Pass 1: opaque meshes ---
+    _mainShader.bind();
+    glUniformMatrix4fv(_mainShader.getUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(_mainShader.getUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    setBattlecruiserLighting(_mainShader, lightPos);
+    drawLods(MaterialPass::Opaque);
+
+    // --- Pass 2: reflective meshes ---
+    glDepthMask(GL_FALSE);
+    _reflectiveShader.bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    glUniform1i(_reflectiveShader.getUniformLocation("environmentMap"), 0);
+    glUniform3fv(_reflectiveShader.getUniformLocation("cameraPos"), 1, glm::value_ptr(cameraPos));
+    glUniformMatrix4fv(_reflectiveShader.getUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(_reflectiveShader.getUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    drawLods(MaterialPass::Glass);
+
+    _instanceRing.fence();
+
+    for (int lod = 0; lod < BattlecruiserMesh::LOD_COUNT; lod++) {
+        const size_t ships = static_cast<size_t>(_lodOffsets[static_cast<size_t>(lod) + 1] -
+                                                 _lodOffsets[static_cast<size_t>(lod)]);
+        _trianglesDrawn += ships * _mesh.getTriangleCount(lod);
+    }
+}
+
+void Fleet::imgui() {
+    ImGui::Separator();
+    ImGui::Text("Fleet");
+
+    int count = getShipCount();
+    if (ImGui::SliderInt("Ships", &count, 0, 10000)) {
+        setShipCount(count);
+    }
+    if (ImGui::SliderFloat("Ship Spacing", &_spacing, 1.0f, 20.0f, "%.1f")) {
+        buildFormation();
+    }
+    ImGui::Checkbox("Simulate Fleet", &_simulate);
+    if (ImGui::CollapsingHeader("Fleet Steering")) {
+        FleetSteeringParams& params = _simulation.params;
+        ImGui::SliderFloat("Neighbor Radius", &params.neighborRadius, 1.0f, 30.0f, "%.1f");
+        ImGui::SliderFloat("Separation Radius", &params.separationRadius, 0.5f, 15.0f, "%.1f");
+        ImGui::SliderInt("Max Neighbors", &params.maxNeighbors, 1, 64);
+        ImGui::SliderFloat("Separation", &params.separationWeight, 0.0f, 5.0f, "%.2f");
+        ImGui::SliderFloat("Alignment", &params.alignmentWeight, 0.0f, 5.0f, "%.2f");
+        ImGui::SliderFloat("Cohesion", &params.cohesionWeight, 0.0f, 5.0f, "%.2f");
+        ImGui::SliderFloat("Planet Avoidance", &params.avoidanceWeight, 0.0f, 20.0f, "%.1f");
+        ImGui::SliderFloat("Avoidance Margin", &params.avoidanceMargin, 0.5f, 50.0f, "%.1f");
+        ImGui::SliderFloat("Fleet Bounds", &params.boundsRadius, 10.0f, 1000.0f, "%.0f");
+        ImGui::DragFloatRange2("Ship Speed", &params.minSpeed, &params.maxSpeed, 0.05f, 0.0f, 20.0f);
+        ImGui::SliderFloat("Max Acceleration", &params.maxAcceleration, 0.1f, 20.0f, "%.1f");
+    }
+    ImGui::Text("Simulation: %.3f ms (grid %.3f ms, steering %.3f ms)", static_cast<double>(_simulationMs),
+                static_cast<double>(_simulation.getGridMs()), static_cast<double>(_simulation.getSteerMs()));
+    ImGui::Text("Ships pushed out of bodies: %d", _contacts);
+
+    ImGui::Checkbox("Frustum Culling", &_cullingEnabled);
+    ImGui::SliderInt("Force LOD (-1 = auto)", &_forcedLod, -1, BattlecruiserMesh::LOD_COUNT - 1);
+    ImGui::SliderFloat2("LOD Thresholds (screen height)", &_lodThresholds.x, 0.0f, 1.0f, "%.3f");
+
+    ImGui::Text("Visible %d / %d (LOD0 %d, LOD1 %d, LOD2 %d)", static_cast<int>(_visible.size()), count,
+                _lodOffsets[1] - _lodOffsets[0], _lodOffsets[2] - _lodOffsets[1], _lodOffsets[3] - _lodOffsets[2]);
+    ImGui::Text("Draw calls %d, triangles %zu", _drawCalls, _trianglesDrawn);
+    ImGui::Text("Cull + LOD: %.3f ms, upload: %.3f ms", static_cast<double>(_cullMs),
+                static_cast<double>(_instanceRing.get_upload_ms()));
+}
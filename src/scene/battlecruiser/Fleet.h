@@ -0,0 +1,75 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+#include <framework/shader.h>
+
+#include "BattlecruiserMesh.h"
+#include "FleetSimulation.h"
+#include "core/config.h"
+#include "core/ThreadPool.h"
+#include "core/UploadRing.h"
+
+// Many battlecruisers sharing one BattlecruiserMesh.
+//
+// Ships are only transforms, moved by a FleetSimulation when simulating is
+// on (config.fleet_simulate). Every frame the ships are culled against the
+// view frustum and given a level of detail by their projected size on the
+// CPU, then the visible model matrices are uploaded grouped by LOD and drawn
+// with one instanced draw per pass, LOD and sub-mesh, however many ships
+// there are.
+class Fleet {
+public:
+    Fleet(const BattlecruiserMesh& mesh, const Config& config, ThreadPool& threadPool);
+
+    // Steers the ships around the bodies and keeps them out of the surfaces
+    void update(float dt, CollisionWorld& collisions);
+
+    void draw(const glm::mat4& view,
+        const glm::mat4& projection,
+        const glm::vec3& lightPos,
+        const glm::vec3& cameraPos,
+        unsigned int cubemapTexture);
+    void imgui();
+
+    // Index of the ship closest along the world-space ray, or -1. Shortens
+    // ray.t on a hit.
+    int pick(Ray& ray) const;
+
+    // Places `count` ships in a grid formation, replacing the current ones
+    void setShipCount(int count);
+    int getShipCount() const { return static_cast<int>(_transforms.size()); }
+
+private:
+    void buildFormation();
+    // Fills _visible with the model matrices of the visible ships, grouped by LOD
+    void cull(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+
+    const BattlecruiserMesh& _mesh;
+    ThreadPool& _threadPool;
+    Shader _mainShader;
+    Shader _reflectiveShader;
+
+    std::vector<glm::mat4> _transforms;  // model matrix per ship
+    FleetSimulation _simulation;
+    bool _simulate;
+    float _spacing;
+    glm::vec3 _center;
+    // Projected sizes (fraction of the screen height) below which LOD 1 and 2 are used
+    glm::vec2 _lodThresholds;
+    bool _cullingEnabled = true;
+    int _forcedLod = -1;  // -1 picks the LOD by projected size
+
+    std::vector<glm::mat4> _visible;
+    std::vector<int> _visibleShips;  // indices into _transforms, scratch of cull()
+    std::vector<uint8_t> _shipLods;
+    std::array<int, BattlecruiserMesh::LOD_COUNT + 1> _lodOffsets{};  // into _visible
+    UploadRing _instanceRing;
+
+    // Stats of the last frame
+    int _drawCalls = 0;
+    size_t _trianglesDrawn = 0;
+    float _cullMs = 0.0f;
+    float _simulationMs = 0.0f;
+    int _contacts = 0;
+};
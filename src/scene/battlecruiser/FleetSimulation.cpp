@@ -0,0 +1,212 @@
+#include "FleetSimulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+static float elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// Acceleration turning velocity v into `direction` at full speed (Reynolds)
+static glm::vec3 steerTowards(const glm::vec3& direction, const glm::vec3& v, float maxSpeed) {
+    float length = glm::length(direction);
+    if (length < 1e-6f) return glm::vec3(0.0f);
+    return direction * (maxSpeed / length) - v;
+}
+
+static glm::vec3 clampLength(const glm::vec3& v, float maxLength) {
+    float length2 = glm::dot(v, v);
+    if (length2 <= maxLength * maxLength) return v;
+    return v * (maxLength / std::sqrt(length2));
+}
+
+void FleetSimulation::reset(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& velocities) {
+    _positions = positions;
+    _velocities = velocities;
+}
+
+void FleetSimulation::tick(float dt, const std::vector<glm::vec4>& obstacles, ThreadPool& threadPool) {
+    const int count = getShipCount();
+    if (count == 0) return;
+
+    auto start = std::chrono::steady_clock::now();
+    _grid.build(_positions, params.neighborRadius, &threadPool);
+    _slotPositions.resize(_positions.size());
+    _slotVelocities.resize(_velocities.size());
+    threadPool.parallel_for(count, 4096, [&](int begin, int end) {
+        for (auto slot = static_cast<uint32_t>(begin); slot < static_cast<uint32_t>(end); slot++) {
+            uint32_t i = _grid.get_point_index(slot);
+            _slotPositions[slot] = _positions[i];
+            _slotVelocities[slot] = _velocities[i];
+        }
+    });
+    _gridMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    threadPool.parallel_for(count, 256, [&](int begin, int end) { steer(begin, end, dt, obstacles); });
+    _steerMs = elapsedMs(start);
+}
+
+// Updates the ships in slots [begin, end), reading the previous state only
+void FleetSimulation::steer(int begin, int end, float dt, const std::vector<glm::vec4>& obstacles) {
+    const FleetSteeringParams& p = params;
+    const float neighborRadius2 = p.neighborRadius * p.neighborRadius;
+    const float separationRadius2 = p.separationRadius * p.separationRadius;
+
+    for (auto slot = static_cast<uint32_t>(begin); slot < static_cast<uint32_t>(end); slot++) {
+        const glm::vec3 position = _slotPositions[slot];
+        const glm::vec3 velocity = _slotVelocities[slot];
+
+        glm::vec3 separation(0.0f);
+        glm::vec3 alignment(0.0f);
+        glm::vec3 cohesion(0.0f);  // offset to the neighbors' center
+        int neighbors = 0;
+        _grid.for_each_near(position, [&](uint32_t other) {
+            if (neighbors >= p.maxNeighbors || other == slot) return;
+            glm::vec3 offset = _slotPositions[other] - position;
+            float distance2 = glm::dot(offset, offset);
+            if (distance2 >= neighborRadius2 || distance2 == 0.0f) return;
+            if (distance2 < separationRadius2) separation -= offset / distance2;
+            alignment += _slotVelocities[other];
+            cohesion += offset;
+            neighbors++;
+        });
+
+        glm::vec3 acceleration(0.0f);
+        if (neighbors > 0) {
+            acceleration += p.separationWeight * steerTowards(separation, velocity, p.maxSpeed);
+            acceleration += p.alignmentWeight * steerTowards(alignment, velocity, p.maxSpeed);
+            acceleration += p.cohesionWeight * steerTowards(cohesion, velocity, p.maxSpeed);
+        }
+
+        // Push away from obstacles near where the ship is heading, harder the deeper it gets
+        const glm::vec3 ahead = position + velocity * p.lookAhead;
+        for (const glm::vec4& obstacle : obstacles) {
+            glm::vec3 away = ahead - glm::vec3(obstacle);
+            float reach = obstacle.w + p.avoidanceMargin;
+            float distance2 = glm::dot(away, away);
+            if (distance2 >= reach * reach) continue;
+            float depth = (reach - std::sqrt(distance2)) / p.avoidanceMargin;
+            acceleration += p.avoidanceWeight * std::min(depth, 1.0f) * steerTowards(away, velocity, p.maxSpeed);
+        }
+
+        const glm::vec3 fromHome = position - home;
+        const float homeDistance = glm::length(fromHome);
+        if (homeDistance > p.boundsRadius) {
+            float excess = (homeDistance - p.boundsRadius) / p.boundsRadius;
+            acceleration += p.containmentWeight * std::min(excess * 10.0f, 1.0f) *
+                            steerTowards(-fromHome, velocity, p.maxSpeed);
+        }
+
+        glm::vec3 newVelocity = velocity + clampLength(acceleration, p.maxAcceleration) * dt;
+        float speed = glm::length(newVelocity);
+        if (speed < 1e-6f) {
+            newVelocity = glm::vec3(0.0f, 0.0f, p.minSpeed);
+        } else {
+            newVelocity *= std::clamp(speed, p.minSpeed, p.maxSpeed) / speed;
+        }
+
+        const uint32_t i = _grid.get_point_index(slot);
+        _velocities[i] = newVelocity;
+        _positions[i] = position + newVelocity * dt;
+    }
+}
+
+int FleetSimulation::resolveContacts(CollisionWorld& collisions, float shipRadius) {
+    _shipSpheres.resize(_positions.size());
+    for (size_t i = 0; i < _positions.size(); i++) {
+        _shipSpheres[i] = glm::vec4(_positions[i], shipRadius);
+    }
+
+    int contacts = 0;
+    collisions.query_spheres(_shipSpheres, 0.0f, [&](int sphere, const Contact& contact) {
+        if (contact.clearance >= 0.0f) return;
+        const size_t ship = static_cast<size_t>(sphere);
+        _positions[ship] -= contact.normal * contact.clearance;
+        const float into = glm::dot(_velocities[ship], contact.normal);
+        if (into < 0.0f) _velocities[ship] -= contact.normal * into;
+        contacts++;
+    });
+    return contacts;
+}
+
+void FleetSimulation::writeTransforms(std::vector<glm::mat4>& transforms, float scale,
+                                      ThreadPool& threadPool) const {
+    const int count = getShipCount();
+    transforms.resize(_positions.size());
+    threadPool.parallel_for(count, 4096, [&](int begin, int end) {
+        for (size_t i = static_cast<size_t>(begin); i < static_cast<size_t>(end); i++) {
+            // Same frame as Battlecruiser::getModelMatrix: model +z along the velocity
+            glm::vec3 forward = glm::normalize(_velocities[i]);
+            glm::vec3 up(0.0f, 1.0f, 0.0f);
+            if (std::abs(forward.y) > 0.999f) up = glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 right = glm::normalize(glm::cross(up, forward));
+            up = glm::cross(forward, right);
+
+            glm::mat4& m = transforms[i];
+            m[0] = glm::vec4(right * scale, 0.0f);
+            m[1] = glm::vec4(up * scale, 0.0f);
+            m[2] = glm::vec4(forward * scale, 0.0f);
+            m[3] = glm::vec4(_positions[i], 1.0f);
+        }
+    });
+}
+
+void benchmarkFleetSimulation(std::ostream& out) {
+    const float spacing = 6.0f;  // same density at every size
+    const float dt = 1.0f / 60.0f;
+    ThreadPool threadPool;
+    ThreadPool noWorkers(0);
+
+    out << "Fleet simulation (" << threadPool.get_thread_count() + 1 << " threads)\n";
+    for (int count : {1000, 10000, 100000}) {
+        const float extent = spacing * std::cbrt(static_cast<float>(count));
+        std::mt19937 mt(42);
+        std::uniform_real_distribution<float> coordinate(-0.5f * extent, 0.5f * extent);
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+        std::vector<glm::vec3> positions(static_cast<size_t>(count));
+        std::vector<glm::vec3> velocities(static_cast<size_t>(count));
+        for (size_t i = 0; i < positions.size(); i++) {
+            positions[i] = {coordinate(mt), coordinate(mt), coordinate(mt)};
+            // mostly heading +z, not all aligned so the neighbors matter
+            velocities[i] = 2.0f * glm::normalize(glm::vec3(direction(mt), direction(mt), 1.0f));
+        }
+        // a few planets inside the fleet
+        std::vector<glm::vec4> obstacles = {{0.0f, 0.0f, 0.0f, 0.1f * extent},
+                                            {0.3f * extent, 0.0f, 0.0f, 0.05f * extent},
+                                            {0.0f, -0.3f * extent, 0.2f * extent, 0.05f * extent}};
+
+        auto ticksPerSecond = [&](ThreadPool& pool, float& gridMs, float& steerMs) {
+            FleetSimulation simulation;
+            simulation.params.boundsRadius = extent;
+            simulation.reset(positions, velocities);
+            simulation.tick(dt, obstacles, pool);  // warm up
+
+            int ticks = 0;
+            gridMs = steerMs = 0.0f;
+            auto start = std::chrono::steady_clock::now();
+            while (ticks < 5 || elapsedMs(start) < 1000.0f) {
+                simulation.tick(dt, obstacles, pool);
+                gridMs += simulation.getGridMs();
+                steerMs += simulation.getSteerMs();
+                ticks++;
+            }
+            double seconds = static_cast<double>(elapsedMs(start)) / 1000.0;
+            gridMs /= static_cast<float>(ticks);
+            steerMs /= static_cast<float>(ticks);
+            return ticks / seconds;
+        };
+
+        float gridMs, steerMs;
+        double serial = ticksPerSecond(noWorkers, gridMs, steerMs);
+        out << "  " << count << " ships, 1 thread:   " << serial << " ticks/s (grid " << gridMs
+            << " ms, steering " << steerMs << " ms)\n";
+        double parallel = ticksPerSecond(threadPool, gridMs, steerMs);
+        out << "  " << count << " ships, all threads: " << parallel << " ticks/s (grid " << gridMs
+            << " ms, steering " << steerMs << " ms)\n";
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <ostream>
+#include <vector>
+
+#include "core/SpatialHashGrid.h"
+#include "core/ThreadPool.h"
+#include "scene/CollisionWorld.h"
+
+// Tunables of the flocking behavior, distances in world units
+struct FleetSteeringParams {
+    float neighborRadius = 8.0f;     // also the spatial hash cell size
+    float separationRadius = 3.0f;
+    int maxNeighbors = 24;           // the first ones found are used, bounds the cost in dense spots
+    float separationWeight = 1.5f;
+    float alignmentWeight = 1.0f;
+    float cohesionWeight = 0.6f;
+    float avoidanceWeight = 6.0f;
+    float avoidanceMargin = 5.0f;    // beyond the obstacle radius
+    float lookAhead = 1.0f;          // seconds, obstacles are avoided where the ship will be
+    float containmentWeight = 1.0f;
+    float boundsRadius = 150.0f;     // ships steer back inside this sphere around home
+    float minSpeed = 1.0f;
+    float maxSpeed = 4.0f;
+    float maxAcceleration = 4.0f;
+};
+
+// Boids-style fleet: separation, alignment and cohesion with the neighbors
+// found in a spatial hash grid rebuilt every tick, plus avoidance of
+// spherical obstacles (planets) and containment around a home point.
+//
+// A tick reads the state of the previous tick only, so ships are split across
+// the thread pool without locks and the result doesn't depend on the split.
+class FleetSimulation {
+public:
+    FleetSteeringParams params;
+    glm::vec3 home{0.0f};
+
+    void reset(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& velocities);
+    // Obstacles are bounding spheres: xyz = center, w = radius
+    void tick(float dt, const std::vector<glm::vec4>& obstacles, ThreadPool& threadPool);
+    // Pushes ships (spheres of `shipRadius`) that ended up inside a body back
+    // onto its surface and drops their velocity into it. Steering avoids the
+    // bodies' bounding spheres already, this catches what it didn't.
+    // Returns the number of contacts.
+    int resolveContacts(CollisionWorld& collisions, float shipRadius);
+    // Model matrices facing the velocity, scaled by `scale`
+    void writeTransforms(std::vector<glm::mat4>& transforms, float scale, ThreadPool& threadPool) const;
+
+    int getShipCount() const { return static_cast<int>(_positions.size()); }
+    const std::vector<glm::vec3>& getPositions() const { return _positions; }
+    const std::vector<glm::vec3>& getVelocities() const { return _velocities; }
+    // CPU time of the last tick's stages
+    float getGridMs() const { return _gridMs; }
+    float getSteerMs() const { return _steerMs; }
+
+private:
+    void steer(int begin, int end, float dt, const std::vector<glm::vec4>& obstacles);
+
+    std::vector<glm::vec3> _positions;
+    std::vector<glm::vec3> _velocities;
+    // Previous state gathered in grid slot order, neighbors are read from here
+    std::vector<glm::vec3> _slotPositions;
+    std::vector<glm::vec3> _slotVelocities;
+    SpatialHashGrid _grid;
+    std::vector<glm::vec4> _shipSpheres;  // scratch of resolveContacts
+
+    float _gridMs = 0.0f;
+    float _steerMs = 0.0f;
+};
+
+// Headless ticks-per-second measurement for 1k, 10k and 100k ships
+void benchmarkFleetSimulation(std::ostream& out);
@@ -0,0 +1,172 @@
+#include "GpuParticles.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+// Interleaved per-particle state: posSize, velocityLife, color, fadeGrowth
+constexpr int FLOATS_PER_PARTICLE = 14;
+constexpr GLsizei STATE_STRIDE = FLOATS_PER_PARTICLE * sizeof(GLfloat);
+constexpr GLuint EMITTER_BLOCK_BINDING = 0;
+}
+
+GpuParticles::GpuParticles(int capacity) : _capacity(capacity) {
+    static const GLfloat quadVertices[] = {
+        -0.5f, -0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        -0.5f, 0.5f, 0.0f,
+        0.5f, 0.5f, 0.0f
+    };
+    glGenBuffers(1, &_vboBillboard);
+    glBindBuffer(GL_ARRAY_BUFFER, _vboBillboard);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+
+    // All slots start dead (zero size and life)
+    std::vector<GLfloat> zeros(static_cast<size_t>(_capacity) * FLOATS_PER_PARTICLE, 0.0f);
+    glGenBuffers(2, _stateBuffers);
+    glGenVertexArrays(2, _updateVaos);
+    glGenVertexArrays(2, _drawVaos);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, _stateBuffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(zeros.size() * sizeof(GLfloat)), zeros.data(),
+                     GL_DYNAMIC_COPY);
+
+        // Update pass reads one vertex per particle
+        glBindVertexArray(_updateVaos[i]);
+        for (GLuint attribute = 0; attribute < 4; attribute++) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribPointer(attribute, attribute < 3 ? 4 : 2, GL_FLOAT, GL_FALSE, STATE_STRIDE,
+                                  (void *) (attribute * 4 * sizeof(GLfloat)));
+        }
+
+        // Draw pass matches the CPU path layout of particle_vertex.glsl
+        glBindVertexArray(_drawVaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, _vboBillboard);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
+        glVertexAttribDivisor(0, 0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, _stateBuffers[i]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, STATE_STRIDE, (void *) 0);
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, STATE_STRIDE, (void *) (8 * sizeof(GLfloat)));
+        glVertexAttribDivisor(2, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &_emitterUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, _emitterUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(EmitterBlock), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    try {
+        updateShader = ShaderBuilder()
+                .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                          "shaders/battlecruiser/particle_update_vert.glsl")
+                .setTransformFeedbackVaryings({"outPositionSize", "outVelocityLife", "outColor", "outFadeGrowth"})
+                .build();
+    } catch (const ShaderLoadingException& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+GpuParticles::~GpuParticles() {
+    glDeleteBuffers(1, &_emitterUbo);
+    glDeleteVertexArrays(2, _drawVaos);
+    glDeleteVertexArrays(2, _updateVaos);
+    glDeleteBuffers(2, _stateBuffers);
+    glDeleteBuffers(1, &_vboBillboard);
+}
+
+template <typename F>
+void GpuParticles::forEachRange(int first, int count, F &&f) const {
+    count = std::min(count, _capacity);
+    if (count <= 0) return;
+    const int head = std::min(count, _capacity - first);
+    f(first, head);
+    if (head < count) f(0, count - head);
+}
+
+void GpuParticles::simulate(float dt, const glm::mat4 &model, const std::vector<Emitter> &emitters,
+                            int spawnCount, float sizeScale, float maxLife) {
+    const int numEmitters = std::min(static_cast<int>(emitters.size()), MAX_EMITTERS);
+    spawnCount = numEmitters > 0 ? std::clamp(spawnCount, 0, _capacity) : 0;
+
+    // The slots to update: those that were live last frame, then the ones
+    // spawned now
+    const int updateFirst = (_spawnCursor - _liveSlots + _capacity) % _capacity;
+    const int updateCount = std::min(_liveSlots + spawnCount, _capacity);
+
+    EmitterBlock block{};
+    block.model = model;
+    for (int i = 0; i < numEmitters; i++) {
+        const Emitter &emitter = emitters[static_cast<size_t>(i)];
+        const ParticleSpawnParams &params = emitter.params;
+        block.origins[i] = glm::vec4(emitter.origin, params.spawnRadius);
+        block.lifetimes[i] = glm::vec4(params.life, params.lifeDeviation, params.fadeOut, params.coneAngle);
+        block.sizes[i] = glm::vec4(params.size * sizeScale, params.sizeDeviation * sizeScale,
+                                   params.sizeGrowth * sizeScale, static_cast<float>(params.shape));
+        block.velocities[i] = glm::vec4(params.speedInitParticle, params.velocitySpread);
+        block.colorsRG[i] = glm::vec4(params.colorR, params.colorG);
+        block.colorsB[i] = glm::vec4(params.colorB, 0.0f, 0.0f);
+    }
+    block.info = glm::ivec4(numEmitters, _spawnCursor, spawnCount, _frame++);
+    _spawnCursor = (_spawnCursor + spawnCount) % _capacity;
+
+    _time += dt;
+    while (!_spawned.empty() && _spawned.front().expires < _time) {
+        _liveSlots -= _spawned.front().count;
+        _spawned.pop_front();
+    }
+    if (spawnCount > 0) {
+        _spawned.push_back({_time + maxLife, spawnCount});
+        _liveSlots += spawnCount;
+    }
+    _liveSlots = std::min(_liveSlots, _capacity);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _emitterUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(EmitterBlock), &block, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    updateShader.bind();
+    updateShader.bindUniformBlock("Emitters", EMITTER_BLOCK_BINDING, _emitterUbo);
+    glUniform1f(updateShader.getUniformLocation("dt"), dt);
+    glUniform1i(updateShader.getUniformLocation("capacity"), _capacity);
+
+    int next = 1 - _current;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(_updateVaos[_current]);
+    // gl_VertexID counts from `first`, so the shader sees the same slots
+    forEachRange(updateFirst, updateCount, [&](int first, int count) {
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _stateBuffers[next],
+                          static_cast<GLintptr>(first) * STATE_STRIDE,
+                          static_cast<GLsizeiptr>(count) * STATE_STRIDE);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, first, count);
+        glEndTransformFeedback();
+    });
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    _current = next;
+}
+
+void GpuParticles::drawInstances() const {
+    glBindVertexArray(_drawVaos[_current]);
+    glBindBuffer(GL_ARRAY_BUFFER, _stateBuffers[_current]);
+    const int first = (_spawnCursor - _liveSlots + _capacity) % _capacity;
+    forEachRange(first, _liveSlots, [&](int rangeFirst, int count) {
+        // no base instance in GL 4.1, so the pointers carry the offset
+        const size_t offset = static_cast<size_t>(rangeFirst) * STATE_STRIDE;
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, STATE_STRIDE, (void *) offset);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, STATE_STRIDE, (void *) (offset + 8 * sizeof(GLfloat)));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    });
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
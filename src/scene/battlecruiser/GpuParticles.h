@@ -0,0 +1,89 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <deque>
+#include <vector>
+#include <glad/glad.h>
+#include <framework/shader.h>
+
+#include "ParticleSpawner.h"
+
+// GPU-resident particle simulation. Particle state lives in two buffers that
+// are ping-ponged through particle_update_vert.glsl with transform feedback
+// (GL 4.0+). Spawning happens in the same pass: every frame a window of the
+// state ring is respawned from the emitter positions and spawn parameters in
+// a small uniform block, which is all the CPU uploads.
+//
+// The spawn window walks the ring, so every particle that can still be alive
+// lies in the slots spawned during the last lifetime bound. Only that range
+// is updated and drawn, which keeps an idle or throttled system cheap however
+// large the ring is.
+class GpuParticles {
+public:
+    // Emitter positions the uniform block holds
+    static constexpr int MAX_EMITTERS = 16;
+
+    // One spawn position with the parameters of the emitter it belongs to
+    struct Emitter {
+        glm::vec3 origin{0.0f};  // model space
+        ParticleSpawnParams params;
+    };
+
+    explicit GpuParticles(int capacity);
+    ~GpuParticles();
+
+    GpuParticles(const GpuParticles&) = delete;
+    GpuParticles& operator=(const GpuParticles&) = delete;
+
+    // Advances all particles by dt and spawns spawnCount new ones spread
+    // evenly over the first MAX_EMITTERS emitters, their sizes scaled by
+    // sizeScale. maxLife bounds the life any of them gives a particle.
+    void simulate(float dt, const glm::mat4& model, const std::vector<Emitter>& emitters, int spawnCount,
+                  float sizeScale, float maxLife);
+
+    // Draws the slots that may hold live particles as instanced billboards
+    // with the currently bound particle shader (dead slots have zero size).
+    void drawInstances() const;
+
+    int getCapacity() const { return _capacity; }
+    // Slots spawned within the lifetime bound, the ones drawn
+    int getLiveSlots() const { return _liveSlots; }
+
+    Shader updateShader;
+
+private:
+    // std140 layout of the Emitters block, one array element per emitter
+    struct EmitterBlock {
+        glm::mat4 model;
+        glm::vec4 origins[MAX_EMITTERS];     // xyz = position, w = spawn radius
+        glm::vec4 lifetimes[MAX_EMITTERS];   // life, life deviation, fade out, cone angle (degrees)
+        glm::vec4 sizes[MAX_EMITTERS];       // size, size deviation, size growth, ParticleSpawnShape
+        glm::vec4 velocities[MAX_EMITTERS];  // xyz = initial velocity in model space, w = velocity spread
+        glm::vec4 colorsRG[MAX_EMITTERS];    // [min, max] red, [min, max] green in 0..255
+        glm::vec4 colorsB[MAX_EMITTERS];     // xy = [min, max] blue
+        glm::ivec4 info;  // x = emitter count, y = first spawn slot, z = spawn count, w = frame seed
+    };
+
+    // Calls f(first, count) for the one or two slot ranges covering `count`
+    // slots of the ring starting at `first`
+    template <typename F>
+    void forEachRange(int first, int count, F&& f) const;
+
+    struct SpawnedFrame {
+        float expires;  // _time at which all of them are dead
+        int count;
+    };
+
+    int _capacity;
+    int _current = 0;    // state buffer holding the latest particles
+    int _spawnCursor = 0;
+    int _frame = 0;
+    float _time = 0.0f;
+    std::deque<SpawnedFrame> _spawned;  // frames whose particles may be alive, oldest first
+    int _liveSlots = 0;                 // sum of their counts, at most _capacity
+
+    GLuint _stateBuffers[2] = {0, 0};
+    GLuint _updateVaos[2] = {0, 0};
+    GLuint _drawVaos[2] = {0, 0};
+    GLuint _vboBillboard = 0;
+    GLuint _emitterUbo = 0;
+};
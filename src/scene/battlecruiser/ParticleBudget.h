@@ -0,0 +1,74 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Scales the particle workload to keep the GPU frame time near a target.
+//
+// The measured frame time is smoothed, and nothing changes while it stays
+// within `hysteresis` of the target, so the budget doesn't oscillate. Over
+// the band the scale drops in proportion to the overshoot; under it the
+// scale recovers slowly. ParticleSystem applies the scale to the spawn rate,
+// the number of alive particles and (less aggressively) the billboard size.
+class ParticleBudget {
+public:
+    enum class State { Steady, Throttling, Recovering };
+
+    bool adaptive = true;
+    float targetFrameMs = 16.6f;
+    float hysteresis = 0.1f;  // fraction of the target
+    float minScale = 0.1f;
+
+    // Feeds the latest GPU frame time; dt is the frame's duration in seconds
+    void update(float frameMs, float dt) {
+        const float smoothing = 1.0f - std::exp(-dt / SMOOTHING_TIME);
+        smoothedMs = hasMeasurement ? smoothedMs + (frameMs - smoothedMs) * smoothing : frameMs;
+        hasMeasurement = true;
+
+        if (!adaptive) {
+            scale = 1.0f;
+            state = State::Steady;
+            return;
+        }
+        if (smoothedMs > targetFrameMs * (1.0f + hysteresis)) {
+            // GPU timings lag a few frames, so back off gradually
+            float overshoot = smoothedMs / targetFrameMs - 1.0f;
+            scale -= scale * std::min(overshoot * DECREASE_RATE * dt, 0.5f);
+            state = State::Throttling;
+        } else if (smoothedMs < targetFrameMs * (1.0f - hysteresis) && scale < 1.0f) {
+            scale += INCREASE_RATE * dt;
+            state = State::Recovering;
+        } else {
+            state = State::Steady;
+        }
+        scale = std::clamp(scale, minScale, 1.0f);
+    }
+
+    float getScale() const { return scale; }
+    float getSmoothedMs() const { return smoothedMs; }
+    State getState() const { return state; }
+
+    int maxAlive(int capacity) const { return std::max(1, static_cast<int>(static_cast<float>(capacity) * scale)); }
+    // Overdraw grows with the square of the size, so halving it at most is plenty
+    float sizeScale() const { return 0.5f + 0.5f * scale; }
+
+    static const char* stateName(State state) {
+        switch (state) {
+            case State::Throttling:
+                return "throttling";
+            case State::Recovering:
+                return "recovering";
+            default:
+                return "steady";
+        }
+    }
+
+private:
+    static constexpr float SMOOTHING_TIME = 0.25f;  // seconds
+    static constexpr float DECREASE_RATE = 2.0f;    // per second and unit of overshoot
+    static constexpr float INCREASE_RATE = 0.2f;    // per second
+
+    float scale = 1.0f;
+    float smoothedMs = 0.0f;
+    bool hasMeasurement = false;
+    State state = State::Steady;
+};
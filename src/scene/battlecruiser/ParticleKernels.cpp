@@ -0,0 +1,286 @@
+#include "ParticleKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PARTICLES_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang only emit AVX instructions in functions marked for it, MSVC
+// allows the intrinsics anywhere.
+#if defined(PARTICLES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PARTICLES_TARGET_AVX __attribute__((target("avx")))
+#else
+#define PARTICLES_TARGET_AVX
+#endif
+
+namespace {
+
+// Raw pointers to the streams the update touches
+struct Streams {
+    float* __restrict posX;
+    float* __restrict posY;
+    float* __restrict posZ;
+    float* __restrict velX;
+    float* __restrict velY;
+    float* __restrict velZ;
+    float* __restrict life;
+    float* __restrict size;
+    float* __restrict alpha;
+    const float* __restrict fadeRate;
+    const float* __restrict sizeGrowth;
+    float* __restrict cameraDistance;
+};
+
+struct Params {
+    float dt;
+    float velocityScale;  // velocity grows by dt / 2 per update
+    glm::vec3 camPos;
+};
+
+// Scalar update of particles [begin, end), also used for the SIMD tails
+void updateScalar(const Streams& s, const Params& p, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        s.life[i] -= p.dt;
+
+        s.velX[i] *= p.velocityScale;
+        s.velY[i] *= p.velocityScale;
+        s.velZ[i] *= p.velocityScale;
+        s.posX[i] += s.velX[i] * p.dt;
+        s.posY[i] += s.velY[i] * p.dt;
+        s.posZ[i] += s.velZ[i] * p.dt;
+
+        float dx = s.posX[i] - p.camPos.x;
+        float dy = s.posY[i] - p.camPos.y;
+        float dz = s.posZ[i] - p.camPos.z;
+        s.cameraDistance[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        s.size[i] = std::max(s.size[i] + s.sizeGrowth[i] * p.dt, 0.0f);
+        s.alpha[i] = std::min(std::max(s.life[i] * s.fadeRate[i], 0.0f), 1.0f);
+    }
+}
+
+#ifdef PARTICLES_X86
+int updateSSE(const Streams& s, const Params& p, int count) {
+    const __m128 dt = _mm_set1_ps(p.dt);
+    const __m128 velocityScale = _mm_set1_ps(p.velocityScale);
+    const __m128 camX = _mm_set1_ps(p.camPos.x);
+    const __m128 camY = _mm_set1_ps(p.camPos.y);
+    const __m128 camZ = _mm_set1_ps(p.camPos.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(s.life + i), dt);
+        _mm_storeu_ps(s.life + i, life);
+
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(s.velX + i), velocityScale);
+        __m128 vy = _mm_mul_ps(_mm_loadu_ps(s.velY + i), velocityScale);
+        __m128 vz = _mm_mul_ps(_mm_loadu_ps(s.velZ + i), velocityScale);
+        _mm_storeu_ps(s.velX + i, vx);
+        _mm_storeu_ps(s.velY + i, vy);
+        _mm_storeu_ps(s.velZ + i, vz);
+
+        __m128 px = _mm_add_ps(_mm_loadu_ps(s.posX + i), _mm_mul_ps(vx, dt));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(s.posY + i), _mm_mul_ps(vy, dt));
+        __m128 pz = _mm_add_ps(_mm_loadu_ps(s.posZ + i), _mm_mul_ps(vz, dt));
+        _mm_storeu_ps(s.posX + i, px);
+        _mm_storeu_ps(s.posY + i, py);
+        _mm_storeu_ps(s.posZ + i, pz);
+
+        __m128 dx = _mm_sub_ps(px, camX);
+        __m128 dy = _mm_sub_ps(py, camY);
+        __m128 dz = _mm_sub_ps(pz, camZ);
+        __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                  _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(s.cameraDistance + i, _mm_sqrt_ps(dist2));
+
+        __m128 size = _mm_add_ps(_mm_loadu_ps(s.size + i),
+                                 _mm_mul_ps(_mm_loadu_ps(s.sizeGrowth + i), dt));
+        _mm_storeu_ps(s.size + i, _mm_max_ps(size, zero));
+
+        __m128 alpha = _mm_mul_ps(life, _mm_loadu_ps(s.fadeRate + i));
+        _mm_storeu_ps(s.alpha + i, _mm_min_ps(_mm_max_ps(alpha, zero), one));
+    }
+    return i;
+}
+
+PARTICLES_TARGET_AVX int updateAVX(const Streams& s, const Params& p, int count) {
+    const __m256 dt = _mm256_set1_ps(p.dt);
+    const __m256 velocityScale = _mm256_set1_ps(p.velocityScale);
+    const __m256 camX = _mm256_set1_ps(p.camPos.x);
+    const __m256 camY = _mm256_set1_ps(p.camPos.y);
+    const __m256 camZ = _mm256_set1_ps(p.camPos.z);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(s.life + i), dt);
+        _mm256_storeu_ps(s.life + i, life);
+
+        __m256 vx = _mm256_mul_ps(_mm256_loadu_ps(s.velX + i), velocityScale);
+        __m256 vy = _mm256_mul_ps(_mm256_loadu_ps(s.velY + i), velocityScale);
+        __m256 vz = _mm256_mul_ps(_mm256_loadu_ps(s.velZ + i), velocityScale);
+        _mm256_storeu_ps(s.velX + i, vx);
+        _mm256_storeu_ps(s.velY + i, vy);
+        _mm256_storeu_ps(s.velZ + i, vz);
+
+        __m256 px = _mm256_add_ps(_mm256_loadu_ps(s.posX + i), _mm256_mul_ps(vx, dt));
+        __m256 py = _mm256_add_ps(_mm256_loadu_ps(s.posY + i), _mm256_mul_ps(vy, dt));
+        __m256 pz = _mm256_add_ps(_mm256_loadu_ps(s.posZ + i), _mm256_mul_ps(vz, dt));
+        _mm256_storeu_ps(s.posX + i, px);
+        _mm256_storeu_ps(s.posY + i, py);
+        _mm256_storeu_ps(s.posZ + i, pz);
+
+        __m256 dx = _mm256_sub_ps(px, camX);
+        __m256 dy = _mm256_sub_ps(py, camY);
+        __m256 dz = _mm256_sub_ps(pz, camZ);
+        __m256 dist2 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+            _mm256_mul_ps(dz, dz));
+        _mm256_storeu_ps(s.cameraDistance + i, _mm256_sqrt_ps(dist2));
+
+        __m256 size = _mm256_add_ps(_mm256_loadu_ps(s.size + i),
+                                    _mm256_mul_ps(_mm256_loadu_ps(s.sizeGrowth + i), dt));
+        _mm256_storeu_ps(s.size + i, _mm256_max_ps(size, zero));
+
+        __m256 alpha = _mm256_mul_ps(life, _mm256_loadu_ps(s.fadeRate + i));
+        _mm256_storeu_ps(s.alpha + i, _mm256_min_ps(_mm256_max_ps(alpha, zero), one));
+    }
+    return i;
+}
+
+bool cpuHasAVX() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    // the OS also has to save the YMM registers on context switches
+    return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    return false;
+#endif
+}
+#endif  // PARTICLES_X86
+
+}  // namespace
+
+bool particleKernelSupported(ParticleKernel kernel) {
+    switch (kernel) {
+        case ParticleKernel::Scalar:
+            return true;
+#ifdef PARTICLES_X86
+        case ParticleKernel::SSE:
+            return true;  // part of the x86-64 baseline
+        case ParticleKernel::AVX: {
+            static const bool hasAVX = cpuHasAVX();
+            return hasAVX;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+ParticleKernel bestParticleKernel() {
+    if (particleKernelSupported(ParticleKernel::AVX)) return ParticleKernel::AVX;
+    if (particleKernelSupported(ParticleKernel::SSE)) return ParticleKernel::SSE;
+    return ParticleKernel::Scalar;
+}
+
+const char* particleKernelName(ParticleKernel kernel) {
+    switch (kernel) {
+        case ParticleKernel::SSE:
+            return "SSE";
+        case ParticleKernel::AVX:
+            return "AVX";
+        default:
+            return "Scalar";
+    }
+}
+
+void updateParticles(ParticleKernel kernel, ParticlePool& pool, float dt,
+                     const glm::vec3& camPos) {
+    updateParticles(kernel, pool, dt, camPos, 0, pool.aliveCount);
+}
+
+void updateParticles(ParticleKernel kernel, ParticlePool& pool, float dt,
+                     const glm::vec3& camPos, int begin, int end) {
+    Streams s{pool.posX.data() + begin, pool.posY.data() + begin, pool.posZ.data() + begin,
+              pool.velX.data() + begin, pool.velY.data() + begin, pool.velZ.data() + begin,
+              pool.life.data() + begin, pool.size.data() + begin, pool.alpha.data() + begin,
+              pool.fadeRate.data() + begin, pool.sizeGrowth.data() + begin,
+              pool.cameraDistance.data() + begin};
+    Params p{dt, 1.0f + dt * 0.5f, camPos};
+    int count = end - begin;
+
+    if (!particleKernelSupported(kernel)) kernel = ParticleKernel::Scalar;
+
+    int done = 0;
+#ifdef PARTICLES_X86
+    if (kernel == ParticleKernel::AVX) {
+        done = updateAVX(s, p, count);
+    } else if (kernel == ParticleKernel::SSE) {
+        done = updateSSE(s, p, count);
+    }
+#endif
+    updateScalar(s, p, done, count);
+}
+
+void benchmarkParticleKernels(std::ostream& out) {
+    const int counts[] = {100000, 1000000};
+    const ParticleKernel kernels[] = {ParticleKernel::Scalar, ParticleKernel::SSE,
+                                      ParticleKernel::AVX};
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    out << "Particle update kernels (integrate + grow + fade + camera distance)\n";
+    for (int count : counts) {
+        ParticlePool pool;
+        pool.resize(count);
+        for (int i = 0; i < count; i++) {
+            const size_t idx = static_cast<size_t>(pool.allocate());
+            pool.posX[idx] = dist(rng);
+            pool.posY[idx] = dist(rng);
+            pool.posZ[idx] = dist(rng);
+            pool.velX[idx] = dist(rng);
+            pool.velY[idx] = dist(rng);
+            pool.velZ[idx] = dist(rng);
+            // long enough that nobody dies during the run
+            pool.life[idx] = 1000.0f;
+            pool.fadeRate[idx] = 2.0f;
+        }
+
+        // same amount of work for both sizes
+        const int iterations = 50000000 / count;
+        for (ParticleKernel kernel : kernels) {
+            if (!particleKernelSupported(kernel)) continue;
+            updateParticles(kernel, pool, 1e-4f, glm::vec3(0.0f));  // warm up
+
+            auto start = std::chrono::steady_clock::now();
+            for (int it = 0; it < iterations; it++) {
+                updateParticles(kernel, pool, 1e-4f, glm::vec3(0.0f));
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+            out << "  " << count << " particles, " << particleKernelName(kernel)
+                << ": " << ms << " ms/update, "
+                << (double)count / ms << " particles/ms\n";
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/glm.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// What to do with spawn requests that don't fit in the pool
+enum class ParticleExhaustionPolicy {
+    Drop,           // skip the new particles
+    RecycleOldest,  // reuse the particles with the least life left
+    Grow,           // enlarge the pool, up to ParticlePool::growLimit
+};
+
+// Particle storage as one array per attribute (structure of arrays). Alive
+// particles are always packed in [0, aliveCount), so the update kernels run
+// over contiguous streams without testing each particle for life.
+struct ParticlePool {
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+    std::vector<float> life;
+    std::vector<float> size;
+    std::vector<float> alpha;           // [0, 1], fades out near the end of life
+    std::vector<float> fadeRate;        // alpha = life * fadeRate, clamped
+    std::vector<float> sizeGrowth;      // size change per second
+    std::vector<float> cameraDistance;
+    std::vector<uint8_t> r, g, b;
+    std::vector<uint8_t> emitter;       // index of the emitter that spawned it
+
+    int capacity = 0;
+    int aliveCount = 0;
+    int growLimit = 0;  // largest capacity ParticleExhaustionPolicy::Grow may reach
+
+    // Lifetime allocation counters
+    uint64_t spawnedCount = 0;
+    uint64_t droppedCount = 0;
+    uint64_t recycledCount = 0;
+
+    void resize(int newCapacity) {
+        capacity = newCapacity;
+        growLimit = std::max(growLimit, capacity);
+        const size_t n = static_cast<size_t>(capacity);
+        for (std::vector<float>* stream : floatStreams()) {
+            stream->assign(n, 0.0f);
+        }
+        r.assign(n, 0);
+        g.assign(n, 0);
+        b.assign(n, 0);
+        emitter.assign(n, 0);
+        aliveCount = 0;
+    }
+
+    // Enlarges the pool, keeping the alive particles
+    void grow(int newCapacity) {
+        if (newCapacity <= capacity) return;
+        capacity = newCapacity;
+        const size_t n = static_cast<size_t>(capacity);
+        for (std::vector<float>* stream : floatStreams()) {
+            stream->resize(n, 0.0f);
+        }
+        r.resize(n, 0);
+        g.resize(n, 0);
+        b.resize(n, 0);
+        emitter.resize(n, 0);
+    }
+
+    // Index of a new particle at the end of the alive range, or -1 if full
+    int allocate() {
+        if (aliveCount >= capacity) return -1;
+        return aliveCount++;
+    }
+
+    // Hands out slots for `count` new particles in `slots`. Free slots are
+    // used first; what remains is handled by `policy`. Costs O(count), plus
+    // one O(aliveCount) selection pass when recycling.
+    void allocateBatch(int count, ParticleExhaustionPolicy policy,
+                       std::vector<int>& slots) {
+        slots.clear();
+        if (count <= 0) return;
+
+        if (count > capacity - aliveCount &&
+            policy == ParticleExhaustionPolicy::Grow && capacity < growLimit) {
+            grow(std::min(growLimit, std::max(capacity * 2, aliveCount + count)));
+        }
+
+        int fresh = std::min(count, capacity - aliveCount);
+        for (int i = 0; i < fresh; i++) {
+            slots.push_back(aliveCount++);
+        }
+
+        int overflow = count - fresh;
+        // only particles that existed before this batch are candidates
+        int candidates = aliveCount - fresh;
+        if (overflow > 0 && candidates > 0 &&
+            policy == ParticleExhaustionPolicy::RecycleOldest) {
+            int recycled = std::min(overflow, candidates);
+            recycleOrder.resize(static_cast<size_t>(candidates));
+            std::iota(recycleOrder.begin(), recycleOrder.end(), 0);
+            std::nth_element(recycleOrder.begin(), recycleOrder.begin() + (recycled - 1),
+                             recycleOrder.end(),
+                             [&](int lhs, int rhs) {
+                                 return life[static_cast<size_t>(lhs)] < life[static_cast<size_t>(rhs)];
+                             });
+            slots.insert(slots.end(), recycleOrder.begin(),
+                         recycleOrder.begin() + recycled);
+            recycledCount += static_cast<uint64_t>(recycled);
+            overflow -= recycled;
+        }
+
+        droppedCount += static_cast<uint64_t>(overflow);
+        spawnedCount += slots.size();
+    }
+
+    // Moves the last alive particle into slot i
+    void swapRemove(int i) {
+        int last = --aliveCount;
+        if (i == last) return;
+        const size_t dst = static_cast<size_t>(i);
+        const size_t src = static_cast<size_t>(last);
+        for (std::vector<float>* stream : floatStreams()) {
+            (*stream)[dst] = (*stream)[src];
+        }
+        r[dst] = r[src];
+        g[dst] = g[src];
+        b[dst] = b[src];
+        emitter[dst] = emitter[src];
+    }
+
+    // Swap-removes every particle whose life ran out, returns how many
+    int removeDead() {
+        int removed = 0;
+        int i = 0;
+        while (i < aliveCount) {
+            if (life[static_cast<size_t>(i)] <= 0.0f) {
+                swapRemove(i);
+                removed++;
+            } else {
+                i++;
+            }
+        }
+        return removed;
+    }
+
+   private:
+    std::vector<int> recycleOrder;
+
+    std::array<std::vector<float>*, 12> floatStreams() {
+        return {&posX, &posY, &posZ, &velX, &velY, &velZ,
+                &life, &size, &alpha, &fadeRate, &sizeGrowth, &cameraDistance};
+    }
+};
@@ -0,0 +1,203 @@
+#include "ParticleSpawner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <random>
+
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/constants.hpp>
+DISABLE_WARNINGS_POP()
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PARTICLE_RNG_SSE2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+// Random numbers drawn per particle, stored plane by plane in the scratch
+enum RandomPlane {
+    RAND_LIFE = 0,
+    RAND_ANGLE,
+    RAND_RADIUS,
+    RAND_ELEVATION,
+    RAND_COS_THETA,
+    RAND_PHI,
+    RAND_JITTER_X,
+    RAND_JITTER_Y,
+    RAND_JITTER_Z,
+    RAND_RED,
+    RAND_GREEN,
+    RAND_BLUE,
+    RAND_SIZE,
+    RAND_COUNT
+};
+
+#ifdef PARTICLE_RNG_SSE2
+// 32 bit multiply of four lanes; SSE2 has no pmulld
+__m128i mulLo32(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// ParticleRng::hash on four lanes
+__m128i hash4(__m128i x) {
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    x = mulLo32(x, _mm_set1_epi32(0x7feb352d));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    x = mulLo32(x, _mm_set1_epi32(static_cast<int>(0x846ca68bu)));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    return x;
+}
+#endif
+
+// Uniform integer in [range.x, range.y] from u in [0, 1), as a color byte
+uint8_t colorChannel(const glm::vec2& range, float u) {
+    float value = std::floor(range.x + u * (range.y - range.x + 1.0f));
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f));
+}
+}
+
+void ParticleRng::fillUniform(float* __restrict out, int count) {
+    const uint32_t key = _key;
+    const uint32_t base = _counter;
+    const float scale = 1.0f / 16777216.0f;  // top 24 bits fit a float mantissa
+    int i = 0;
+#ifdef PARTICLE_RNG_SSE2
+    const __m128i keys = _mm_set1_epi32(static_cast<int>(key));
+    const __m128 scales = _mm_set1_ps(scale);
+    __m128i counters = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(base)), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i step = _mm_set1_epi32(4);
+    for (; i + 4 <= count; i += 4) {
+        __m128i bits = hash4(_mm_xor_si128(counters, keys));
+        __m128 values = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), scales);
+        _mm_storeu_ps(out + i, values);
+        counters = _mm_add_epi32(counters, step);
+    }
+#endif
+    for (; i < count; i++) {
+        uint32_t bits = hash((base + static_cast<uint32_t>(i)) ^ key);
+        out[i] = static_cast<float>(bits >> 8) * scale;
+    }
+    _counter = base + static_cast<uint32_t>(count);
+}
+
+void spawnParticles(ParticlePool& pool, const std::vector<int>& slots,
+                    const ParticleEmitter& emitter, const ParticleSpawnParams& params,
+                    ParticleRng& rng, std::vector<float>& scratch) {
+    const size_t count = slots.size();
+    if (count == 0) return;
+
+    scratch.resize(count * RAND_COUNT);
+    rng.fillUniform(scratch.data(), static_cast<int>(scratch.size()));
+    auto random = [&](RandomPlane plane, size_t i) {
+        return scratch[static_cast<size_t>(plane) * count + i];
+    };
+
+    const float oneMinusCosCone = 1.0f - std::cos(glm::radians(params.coneAngle));
+    const float fadeRate = 1.0f / std::max(params.fadeOut, 1e-6f);
+    const glm::vec3 initialVelocity = emitter.rotation * params.speedInitParticle;
+
+    for (size_t i = 0; i < count; i++) {
+        const size_t idx = static_cast<size_t>(slots[i]);
+
+        pool.life[idx] = params.life + random(RAND_LIFE, i) * params.lifeDeviation;
+
+        // --- spatial spread over the spawn shape ---
+        float angle = glm::two_pi<float>() * random(RAND_ANGLE, i);
+        glm::vec3 offset(0.0f);
+        if (params.shape == ParticleSpawnShape::Disc) {
+            float radius = params.spawnRadius * std::sqrt(random(RAND_RADIUS, i));
+            offset = glm::vec3(radius * std::cos(angle), radius * std::sin(angle), 0.0f);
+        } else if (params.shape == ParticleSpawnShape::Sphere) {
+            float radius = params.spawnRadius * std::cbrt(random(RAND_RADIUS, i));
+            float z = 2.0f * random(RAND_ELEVATION, i) - 1.0f;
+            float ring = std::sqrt(std::max(1.0f - z * z, 0.0f));
+            offset = radius * glm::vec3(ring * std::cos(angle), ring * std::sin(angle), z);
+        }
+        glm::vec3 spawnPosLocal = emitter.origin + offset;
+        glm::vec3 pos = glm::vec3(emitter.transform * glm::vec4(spawnPosLocal, 1.0f));
+        pool.posX[idx] = pos.x;
+        pool.posY[idx] = pos.y;
+        pool.posZ[idx] = pos.z;
+
+        // --- cone directional spread ---
+        float cosTheta = 1.0f - random(RAND_COS_THETA, i) * oneMinusCosCone;
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        float phi = glm::two_pi<float>() * random(RAND_PHI, i);
+        glm::vec3 dir(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+
+        // --- velocity with jitter ---
+        glm::vec3 jitter(
+            (random(RAND_JITTER_X, i) - 0.5f) * params.velocitySpread,
+            (random(RAND_JITTER_Y, i) - 0.5f) * params.velocitySpread,
+            (random(RAND_JITTER_Z, i) - 0.5f) * params.velocitySpread);
+        glm::vec3 speed = emitter.rotation * dir + initialVelocity + jitter;
+        pool.velX[idx] = speed.x;
+        pool.velY[idx] = speed.y;
+        pool.velZ[idx] = speed.z;
+
+        // --- color and size ---
+        pool.r[idx] = colorChannel(params.colorR, random(RAND_RED, i));
+        pool.g[idx] = colorChannel(params.colorG, random(RAND_GREEN, i));
+        pool.b[idx] = colorChannel(params.colorB, random(RAND_BLUE, i));
+        pool.alpha[idx] = 1.0f;
+        pool.fadeRate[idx] = fadeRate;
+        pool.emitter[idx] = emitter.id;
+
+        pool.size[idx] = params.size + random(RAND_SIZE, i) * params.sizeDeviation;
+        pool.sizeGrowth[idx] = params.sizeGrowth;
+        pool.cameraDistance[idx] = -1.0f;
+    }
+}
+
+void benchmarkParticleSpawning(std::ostream& out) {
+    const int count = 1000000;
+    const int iterations = 20;
+    ParticleSpawnParams params;
+    ParticleEmitter emitter;
+
+    ParticlePool pool;
+    pool.resize(count);
+    std::vector<int> slots(count);
+    for (int& slot : slots) slot = pool.allocate();
+    std::vector<float> scratch;
+
+    auto msPerIteration = [&](auto&& body) {
+        body();  // warm up
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) body();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    };
+
+    out << "Particle spawning (" << count << " particles)\n";
+
+    std::mt19937 mt(42);
+    std::uniform_real_distribution<float> dist01(0.0f, 1.0f);
+    scratch.resize(static_cast<size_t>(count) * RAND_COUNT);
+    double ms = msPerIteration([&]() {
+        for (float& value : scratch) value = dist01(mt);
+    });
+    out << "  std::mt19937 random numbers: " << ms << " ms\n";
+
+    ParticleRng rng(42);
+    ms = msPerIteration([&]() { rng.fillUniform(scratch.data(), static_cast<int>(scratch.size())); });
+    out << "  ParticleRng random numbers:  " << ms << " ms\n";
+
+    ms = msPerIteration([&]() { spawnParticles(pool, slots, emitter, params, rng, scratch); });
+    out << "  batched spawn: " << ms << " ms, " << (double)count / ms << " particles/ms\n";
+
+    // Same seed, same particles
+    std::vector<float> first;
+    rng.reseed(7);
+    spawnParticles(pool, slots, emitter, params, rng, scratch);
+    first.assign(pool.velX.begin(), pool.velX.begin() + count);
+    rng.reseed(7);
+    spawnParticles(pool, slots, emitter, params, rng, scratch);
+    bool reproducible = std::equal(first.begin(), first.end(), pool.velX.begin());
+    out << "  reproducible with equal seeds: " << (reproducible ? "yes" : "NO") << "\n";
+}
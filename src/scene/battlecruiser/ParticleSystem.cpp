@@ -1,23 +1,100 @@
 #include "ParticleSystem.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 #include <cstdlib>
 #include <framework/shader.h>
-#include <random>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <framework/disable_all_warnings.h>
+
+DISABLE_WARNINGS_PUSH()
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+
+static float elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
 
-ParticleSystem::ParticleSystem(Battlecruiser &battlecruiser, int maxParticles)
-    : battlecruiser(battlecruiser),
-      _maxParticles(maxParticles),
-      _lastUsedParticle(0),
-      _particles(maxParticles),
-      _posSizeData(maxParticles * 4),
-      _colorData(maxParticles * 4) {
-    _aliveCount = 0;
+static ParticleSpawnShape parseSpawnShape(const std::string &shape) {
+    if (shape == "point") return ParticleSpawnShape::Point;
+    if (shape == "sphere") return ParticleSpawnShape::Sphere;
+    if (shape != "disc") {
+        std::cerr << "Unknown particle emitter shape \"" << shape << "\", using disc" << std::endl;
+    }
+    return ParticleSpawnShape::Disc;
+}
 
-    // Init particles as dead
-    for (auto &p: _particles) {
-        p.life = -1.0f;
-        p.cameraDistance = -1.0f;
+ParticleSystem::ParticleSystem(Battlecruiser &parent, const Config &config, ThreadPool &threadPool)
+    : battlecruiser(parent),
+      _maxParticles(std::max(config.particle_pool_size, 1)),
+      _threadPool(threadPool),
+      _kernel(bestParticleKernel()),
+      _instanceRing(GL_ARRAY_BUFFER, static_cast<size_t>(_maxParticles) * sizeof(ParticleInstance)) {
+    _rng.reseed(static_cast<uint32_t>(_seed));
+
+    for (const Config::EmitterInfo &info: config.emitters) {
+        if (_emitterConfigs.size() == MAX_EMITTERS) {
+            std::cerr << "Only " << MAX_EMITTERS << " particle emitters are supported" << std::endl;
+            break;
+        }
+        EmitterConfig emitter;
+        emitter.name = info.name;
+        emitter.positions = info.positions;
+        emitter.rate = info.rate;
+        emitter.maxPerFrame = info.max_per_frame;
+        emitter.burst = info.burst;
+        emitter.burstInterval = info.burst_interval;
+        emitter.budget = info.budget;
+
+        ParticleSpawnParams &params = emitter.params;
+        params.speedInitParticle = info.initial_velocity;
+        params.colorR = info.color_r;
+        params.colorG = info.color_g;
+        params.colorB = info.color_b;
+        params.life = info.life;
+        params.lifeDeviation = info.life_deviation;
+        params.fadeOut = info.fade_out;
+        params.size = info.size;
+        params.sizeDeviation = info.size_deviation;
+        params.sizeGrowth = info.size_growth;
+        params.shape = parseSpawnShape(info.shape);
+        params.spawnRadius = info.radius;
+        params.coneAngle = info.cone_angle;
+        params.velocitySpread = info.velocity_spread;
+        _emitterConfigs.push_back(emitter);
+    }
+    if (_emitterConfigs.empty()) {
+        EmitterConfig emitter;
+        emitter.name = "thrusters";
+        emitter.positions = battlecruiser.getRelativePositionThrusters();
+        _emitterConfigs.push_back(emitter);
+    }
+    // The GPU backend spawns from one uniform block slot per emitter position
+    for (size_t id = 0; id < _emitterConfigs.size(); ++id) {
+        for (const glm::vec3 &position: _emitterConfigs[id].positions) {
+            if (_gpuEmitters.size() == GpuParticles::MAX_EMITTERS) {
+                std::cerr << "Only " << GpuParticles::MAX_EMITTERS
+                          << " emitter positions are supported by the GPU particle backend" << std::endl;
+                break;
+            }
+            _gpuEmitters.push_back({position, _emitterConfigs[id].params});
+            _gpuEmitterIds.push_back(id);
+        }
     }
+    _emitterStates.resize(_emitterConfigs.size());
+    _stats.emitterAlive.assign(_emitterConfigs.size(), 0);
+
+    _pool.resize(_maxParticles);
+    _pool.growLimit = 4 * _maxParticles;
+    _drawOrder.reserve(static_cast<size_t>(_maxParticles));
+    _sortKeys.reserve(static_cast<size_t>(_maxParticles));
+    _sortScratch.reserve(static_cast<size_t>(_maxParticles));
 
     // Quad geometry (billboard)
     static const GLfloat quadVertices[] = {
@@ -37,18 +114,11 @@ ParticleSystem::ParticleSystem(Battlecruiser &battlecruiser, int maxParticles)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *) 0);
     glVertexAttribDivisor(0, 0);
 
-    glGenBuffers(1, &_vboPositions);
-    glBindBuffer(GL_ARRAY_BUFFER, _vboPositions);
-    glBufferData(GL_ARRAY_BUFFER, _maxParticles * 4 * sizeof(GLfloat), nullptr, GL_STREAM_DRAW);
+    // Per-instance position/size and color, interleaved in the upload ring.
+    // The pointers are re-specified per draw with the ring offset.
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void *) 0);
     glVertexAttribDivisor(1, 1);
-
-    glGenBuffers(1, &_vboColors);
-    glBindBuffer(GL_ARRAY_BUFFER, _vboColors);
-    glBufferData(GL_ARRAY_BUFFER, _maxParticles * 4 * sizeof(GLubyte), nullptr, GL_STREAM_DRAW);
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void *) 0);
     glVertexAttribDivisor(2, 1);
 
     glBindVertexArray(0);
@@ -59,177 +129,509 @@ ParticleSystem::ParticleSystem(Battlecruiser &battlecruiser, int maxParticles)
             .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
                       "shaders/battlecruiser/particle_frag.glsl")
             .build();
+    _oitShader = ShaderBuilder()
+            .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                      "shaders/battlecruiser/particle_vertex.glsl")
+            .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
+                      "shaders/battlecruiser/particle_oit_frag.glsl")
+            .build();
 }
 
 ParticleSystem::~ParticleSystem() {
+    join();
     glDeleteBuffers(1, &_vboBillboard);
-    glDeleteBuffers(1, &_vboPositions);
-    glDeleteBuffers(1, &_vboColors);
     glDeleteVertexArrays(1, &_vao);
 }
 
-int ParticleSystem::findUnusedParticle() {
-    for (int i = _lastUsedParticle; i < _maxParticles; i++) {
-        if (_particles[i].life < 0) {
-            _lastUsedParticle = i;
-            return i;
-        }
-    }
-    for (int i = 0; i < _lastUsedParticle; i++) {
-        if (_particles[i].life < 0) {
-            _lastUsedParticle = i;
-            return i;
-        }
-    }
-    return 0;
+void ParticleSystem::spawn(const ParticleEmitter &emitter, const ParticleSpawnParams &params, int count) {
+    if (count <= 0) return;
+    // Slots for the whole burst at once, so a full pool costs one policy
+    // decision per batch rather than one per particle
+    _pool.allocateBatch(count, _input.exhaustionPolicy, _spawnSlots);
+    spawnParticles(_pool, _spawnSlots, emitter, params, _rng, _spawnRandom);
 }
 
-void ParticleSystem::spawn_per_location(const glm::vec3 &origin) {
-    static thread_local std::mt19937 rng(std::random_device{}());
-    static thread_local std::uniform_real_distribution<float> dist01(0.0f, 1.0f);
+void ParticleSystem::reseed(uint32_t seed) {
+    _seed = static_cast<int>(seed);
+    _reseedPending = true;
+}
 
-    int idx = findUnusedParticle();
-    Particle &p = _particles[idx];
+void ParticleSystem::spawn_stage(float dt) {
+    // alive particles per emitter, for the budgets
+    for (EmitterState &emitter: _emitterStates) emitter.alive = 0;
+    for (int i = 0; i < _pool.aliveCount; i++) {
+        _emitterStates[_pool.emitter[static_cast<size_t>(i)]].alive++;
+    }
 
-    p.life = life + dist01(rng) * lifeDeviation;
+    // spawns left under the budget; the pool policies handle the rest
+    int room = _input.maxAlive > 0 ? std::max(_input.maxAlive - _pool.aliveCount, 0)
+                                   : std::numeric_limits<int>::max();
+
+    const glm::mat4 &model = _input.model;
+    const glm::mat3 rotation(model);
+    for (size_t id = 0; id < _emitterStates.size(); id++) {
+        EmitterState &state = _emitterStates[id];
+        const EmitterConfig &emitter = state.config;
+        const int positions = static_cast<int>(emitter.positions.size());
+        if (positions == 0) continue;
+
+        float wanted = emitter.rate * dt + state.rateCarry;
+        int perPosition = static_cast<int>(wanted);
+        state.rateCarry = wanted - static_cast<float>(perPosition);
+        perPosition = std::min(perPosition, emitter.maxPerFrame);
+        if (emitter.burstInterval > 0.0f) {
+            state.burstTimer += dt;
+            if (state.burstTimer >= emitter.burstInterval) {
+                // one burst per frame at most, however long the frame was
+                state.burstTimer = std::fmod(state.burstTimer, emitter.burstInterval);
+                perPosition += emitter.burst;
+            }
+        }
 
-    // --- spatial radius spread ---
-    float angle = glm::two_pi<float>() * dist01(rng);
-    float radius = spawnRadius * sqrt(dist01(rng));
-    glm::vec3 offset(radius * cos(angle), radius * sin(angle), 0.0f);
-    glm::vec3 spawnPosLocal = origin + offset;
+        int total = std::min(perPosition * positions, room);
+        if (emitter.budget > 0) {
+            total = std::min(total, std::max(emitter.budget - state.alive, 0));
+        }
+        room -= total;
+        for (int k = 0; k < positions; k++) {
+            // spread what the budget allows evenly over the positions
+            int count = total / positions + (k < total % positions ? 1 : 0);
+            ParticleEmitter source{model, rotation, emitter.positions[static_cast<size_t>(k)],
+                                   static_cast<uint8_t>(id)};
+            spawn(source, emitter.params, count);
+        }
+    }
+}
 
-    // --- position in world space ---
-    p.pos = glm::vec3(battlecruiser.getModelMatrix() * glm::vec4(spawnPosLocal, 1.0f));
+void ParticleSystem::update_stage(float dt, const glm::vec3 &camPos) {
+    // chunks big enough that scheduling stays well below the kernel cost
+    constexpr int UPDATE_CHUNK = 16384;
+    constexpr int FILL_CHUNK = 16384;
+
+    auto start = std::chrono::steady_clock::now();
+    _threadPool.parallel_for(_pool.aliveCount, UPDATE_CHUNK, [&](int begin, int end) {
+        updateParticles(_kernel, _pool, dt, camPos, begin, end);
+    });
+    _pool.removeDead();
+    _updateMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    sort_stage();
+    _sortMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<ParticleInstance> &instances = _instanceData[_writeBuffer];
+    if (instances.size() < (size_t) _pool.capacity) {
+        instances.resize(static_cast<size_t>(_pool.capacity));
+    }
+    const int count = static_cast<int>(_drawOrder.size());
+    _threadPool.parallel_for(count, FILL_CHUNK, [&](int begin, int end) {
+        for (int k = begin; k < end; k++) {
+            const size_t i = static_cast<size_t>(_drawOrder[static_cast<size_t>(k)]);
+            ParticleInstance &instance = instances[static_cast<size_t>(k)];
+            instance.x = _pool.posX[i];
+            instance.y = _pool.posY[i];
+            instance.z = _pool.posZ[i];
+            instance.size = _pool.size[i];
+            instance.r = _pool.r[i];
+            instance.g = _pool.g[i];
+            instance.b = _pool.b[i];
+            instance.a = static_cast<GLubyte>(_pool.alpha[i] * 255.0f);
+        }
+    });
+
+    // bounds for occlusion tests, padded by the largest billboard
+    const int alive = _pool.aliveCount;
+    if (alive > 0) {
+        auto [minX, maxX] = std::minmax_element(_pool.posX.begin(), _pool.posX.begin() + alive);
+        auto [minY, maxY] = std::minmax_element(_pool.posY.begin(), _pool.posY.begin() + alive);
+        auto [minZ, maxZ] = std::minmax_element(_pool.posZ.begin(), _pool.posZ.begin() + alive);
+        const float pad = *std::max_element(_pool.size.begin(), _pool.size.begin() + alive);
+        _instanceBoundsMin[_writeBuffer] = glm::vec3(*minX, *minY, *minZ) - pad;
+        _instanceBoundsMax[_writeBuffer] = glm::vec3(*maxX, *maxY, *maxZ) + pad;
+    }
+    _fillMs = elapsedMs(start);
 
-    // --- cone directional spread ---
-    float coneAngleRad = glm::radians(coneAngle);
-    float cosTheta = 1.0f - dist01(rng) * (1.0f - cos(coneAngleRad));
-    float sinTheta = sqrt(1.0f - cosTheta * cosTheta);
-    float phi = glm::two_pi<float>() * dist01(rng);
-    glm::vec3 dir(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+    _instanceCount[_writeBuffer] = count;
+}
 
-    glm::mat3 rotation(battlecruiser.getModelMatrix());
-    glm::vec3 worldDir = rotation * dir;
+// Orders the alive particles back to front into _drawOrder. Distances are
+// quantized to 16 bits relative to the farthest particle and sorted with a
+// two pass LSD radix sort (8 bits per pass) over particle indices.
+void ParticleSystem::sort_stage() {
+    const size_t count = static_cast<size_t>(_pool.aliveCount);
+    _drawOrder.resize(count);
 
-    // --- velocity with jitter ---
-    glm::vec3 jitter(
-        (dist01(rng) - 0.5f) * velocitySpread,
-        (dist01(rng) - 0.5f) * velocitySpread,
-        (dist01(rng) - 0.5f) * velocitySpread
-    );
+    if (_input.blendMode != ParticleBlendMode::AlphaSorted) {
+        for (size_t i = 0; i < count; i++) {
+            _drawOrder[i] = static_cast<int>(i);
+        }
+        return;
+    }
 
-    p.speed = worldDir + (rotation * speedInitParticle) + jitter;
+    const float *distance = _pool.cameraDistance.data();
+    float maxDistance = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        maxDistance = std::max(maxDistance, distance[i]);
+    }
+    float scale = maxDistance > 0.0f ? 65535.0f / maxDistance : 0.0f;
 
-    // --- color and size ---
-    std::uniform_int_distribution<int> distR(colorR.x, colorR.y);
-    std::uniform_int_distribution<int> distG(colorG.x, colorG.y);
-    std::uniform_int_distribution<int> distB(colorB.x, colorB.y);
+    // farthest particle gets the smallest key
+    _sortKeys.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        _sortKeys[i] = static_cast<uint16_t>(65535.0f - distance[i] * scale);
+    }
 
-    p.r = static_cast<unsigned char>(distR(rng));
-    p.g = static_cast<unsigned char>(distG(rng));
-    p.b = static_cast<unsigned char>(distB(rng));
-    p.a = 255;
+    _sortScratch.resize(count);
+    int histogram[2][256] = {};
+    for (size_t i = 0; i < count; i++) {
+        histogram[0][_sortKeys[i] & 0xFF]++;
+        histogram[1][_sortKeys[i] >> 8]++;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        int offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            int n = histogram[pass][bucket];
+            histogram[pass][bucket] = offset;
+            offset += n;
+        }
+    }
 
-    p.size = size + dist01(rng) * sizeDeviation;
-    p.cameraDistance = -1.0f;
+    // low byte: identity order -> scratch, high byte: scratch -> draw order
+    for (size_t i = 0; i < count; i++) {
+        _sortScratch[static_cast<size_t>(histogram[0][_sortKeys[i] & 0xFF]++)] = static_cast<int>(i);
+    }
+    for (int i: _sortScratch) {
+        _drawOrder[static_cast<size_t>(histogram[1][_sortKeys[static_cast<size_t>(i)] >> 8]++)] = i;
+    }
 }
 
-void ParticleSystem::spawn_stage(float dt) {
-    float particlesPerSecond = 1000.0f;
-    int newParticles =
-            static_cast<int>(dt * particlesPerSecond);
-    if (newParticles > 500) newParticles = 500;
-
-    for (int i = 0; i < newParticles; ++i) {
-        for (int j = 0;
-             j < battlecruiser.getRelativePositionThrusters().size();
-             j++) {
-            spawn_per_location(battlecruiser.getRelativePositionThrusters()[j]);
-        }
+void ParticleSystem::draw_stage(const glm::mat4 &view, const glm::mat4 &projection,
+                                const glm::ivec2 &framebufferSize, OcclusionCuller *occlusion) {
+    glm::vec3 camRight(view[0][0], view[1][0], view[2][0]);
+    glm::vec3 camUp(view[0][1], view[1][1], view[2][1]);
+
+    if (_backend == ParticleBackend::GPU) {
+        simulate_gpu();
+    } else if (_readBuffer == _writeBuffer) {
+        // not simulating ahead, the running job fills the buffer drawn now
+        join();
     }
-}
 
-void ParticleSystem::update_stage(float dt, const glm::vec3 &camPos) {
-    for (auto &p: _particles) {
-        if (p.life > 0.0f) {
-            p.life -= dt;
-            if (p.life > 0.0f) {
-                // World-space motion
-                p.speed += p.speed * dt * 0.5f;
-                p.pos += p.speed * dt;
-
-                // Camera distance directly in world space
-                p.cameraDistance = glm::length(p.pos - camPos);
-
-                if (p.life < lifeThreshold) {
-                    float lifeDiv = p.life / lifeThreshold;
-                    p.a = static_cast<GLubyte>(glm::clamp(lifeDiv * 255.0f, 0.0f, 255.0f));
-                }
-            } else {
-                p.cameraDistance = -1.0f;
-            }
+    // particles are drawn last, so everything else can hide them
+    if (occlusion != nullptr && _backend == ParticleBackend::CPU && _instanceCount[_readBuffer] > 0 &&
+        !occlusion->test_box(this, glm::mat4(1.0f), _instanceBoundsMin[_readBuffer],
+                             _instanceBoundsMax[_readBuffer])) {
+        return;
+    }
+
+    ParticleBlendMode drawnMode = _blendMode;
+    _drawTimer.begin();
+
+    if (_blendMode == ParticleBlendMode::WeightedOIT) {
+        if (!_oit) _oit = std::make_unique<WeightedOIT>();
+        _oit->begin(framebufferSize.x, framebufferSize.y);
+    } else {
+        glDepthMask(GL_FALSE);
+        if (_blendMode == ParticleBlendMode::Additive) {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
         }
     }
 
-    std::sort(_particles.begin(), _particles.end());
+    const Shader &drawShader = _blendMode == ParticleBlendMode::WeightedOIT ? _oitShader : shader;
+    drawShader.bind();
+    glUniformMatrix4fv(drawShader.getUniformLocation("model"), 1, GL_FALSE, glm::value_ptr(battlecruiser.getModelMatrix()));
+    glUniformMatrix4fv(drawShader.getUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(drawShader.getUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
 
-    int count = 0;
-    for (auto &p: _particles) {
-        if (p.life > 0.0f) {
-            _posSizeData[4 * count + 0] = p.pos.x;
-            _posSizeData[4 * count + 1] = p.pos.y;
-            _posSizeData[4 * count + 2] = p.pos.z;
-            _posSizeData[4 * count + 3] = p.size;
+    glUniform3fv(drawShader.getUniformLocation("CameraRight_worldspace"), 1, glm::value_ptr(camRight));
+    glUniform3fv(drawShader.getUniformLocation("CameraUp_worldspace"), 1, glm::value_ptr(camUp));
 
-            _colorData[4 * count + 0] = p.r;
-            _colorData[4 * count + 1] = p.g;
-            _colorData[4 * count + 2] = p.b;
-            _colorData[4 * count + 3] = p.a;
+    draw_instances();
 
-            ++count;
-        } else break;
+    if (_blendMode == ParticleBlendMode::WeightedOIT) {
+        _oit->composite();
     }
 
-    _aliveCount = count;
+    _drawTimer.end();
+    record_blend_timings(drawnMode);
 }
 
-void ParticleSystem::draw_stage(const glm::mat4 &view, const glm::mat4 &projection) {
-    glm::vec3 camRight(view[0][0], view[1][0], view[2][0]);
-    glm::vec3 camUp(view[0][1], view[1][1], view[2][1]);
-
-    glDepthMask(GL_FALSE);
-
-    shader.bind();
-    glUniformMatrix4fv(shader.getUniformLocation("model"), 1, GL_FALSE, glm::value_ptr(battlecruiser.getModelMatrix()));
-    glUniformMatrix4fv(shader.getUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(shader.getUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
-
-    glUniform3fv(shader.getUniformLocation("CameraRight_worldspace"), 1, glm::value_ptr(camRight));
-    glUniform3fv(shader.getUniformLocation("CameraUp_worldspace"), 1, glm::value_ptr(camUp));
+void ParticleSystem::draw_instances() {
+    if (_backend == ParticleBackend::GPU) {
+        _gpu->drawInstances();
+        return;
+    }
 
     glBindVertexArray(_vao);
 
     // Only draw alive particles!
-    int count = _aliveCount;
+    int count = _instanceCount[_readBuffer];
 
     if (count > 0) {
-        // Upload position/size data
-        glBindBuffer(GL_ARRAY_BUFFER, _vboPositions);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(GLfloat), _posSizeData.data());
-
-        // Upload color data
-        glBindBuffer(GL_ARRAY_BUFFER, _vboColors);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(GLubyte), _colorData.data());
+        // Upload interleaved position/size/color (grows with the pool)
+        size_t offset = _instanceRing.upload(_instanceData[_readBuffer].data(),
+                                             static_cast<size_t>(count) * sizeof(ParticleInstance));
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance),
+                              (void *) (offset + offsetof(ParticleInstance, x)));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance),
+                              (void *) (offset + offsetof(ParticleInstance, r)));
 
         // Draw instanced quads
         glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        _instanceRing.fence();
     }
 
     glBindVertexArray(0);
 }
 
+// Running averages of the sort (CPU) and draw (GPU) cost of each blend mode.
+// GPU times arrive GpuTimer::LATENCY frames late, so the first frames after
+// a mode switch are skipped. Also steps the "Compare" run through the modes.
+void ParticleSystem::record_blend_timings(ParticleBlendMode mode) {
+    int m = static_cast<int>(mode);
+    if (mode != _lastDrawnMode) {
+        _lastDrawnMode = mode;
+        _framesInMode = 0;
+    }
+    _framesInMode++;
+
+    if (_framesInMode > GpuTimer::LATENCY && _drawTimer.has_measurement()) {
+        BlendTiming &timing = _blendTimings[m];
+        const float smoothing = timing.samples == 0 ? 1.0f : 0.05f;
+        timing.sortMs += (_stats.sortMs - timing.sortMs) * smoothing;
+        timing.drawMs += (_drawTimer.get_ms() - timing.drawMs) * smoothing;
+        timing.alive = _backend == ParticleBackend::GPU ? _gpuCapacity : _instanceCount[_readBuffer];
+        timing.samples++;
+    }
+
+    if (_compareFramesLeft > 0 && --_compareFramesLeft == 0) {
+        int next = m + 1;
+        if (next < PARTICLE_BLEND_MODE_COUNT) {
+            _blendMode = static_cast<ParticleBlendMode>(next);
+            _compareFramesLeft = COMPARE_FRAMES_PER_MODE;
+        } else {
+            _blendMode = _blendModeBeforeCompare;
+        }
+    }
+}
+
 void ParticleSystem::update(const glm::vec3 &camPos, const float dt) {
-    spawn_stage(dt);
-    update_stage(dt, camPos);
+    // with simulate-ahead on, the previous frame's simulation is still running
+    join();
+    if (_backend == ParticleBackend::GPU) {
+        // simulated on the GPU in draw_stage
+        if (_hasFrameGpuMs) {
+            _budget.update(_frameGpuMs, dt);
+        }
+        _gpuPendingDt += dt;
+        return;
+    }
+
+    // draw what was just finished, simulate into the other buffer meanwhile
+    _readBuffer = _writeBuffer;
+    if (_simulateAhead) {
+        _writeBuffer = 1 - _readBuffer;
+    }
+
+    if (_reseedPending) {
+        _rng.reseed(static_cast<uint32_t>(_seed));
+        _reseedPending = false;
+    }
+    // scale this frame's work to the budget
+    if (_hasFrameGpuMs) {
+        _budget.update(_frameGpuMs, dt);
+    }
+    const float scale = _budget.getScale();
+    const float sizeScale = _budget.sizeScale();
+    for (size_t id = 0; id < _emitterStates.size(); id++) {
+        EmitterConfig &config = _emitterStates[id].config;
+        config = _emitterConfigs[id];
+        config.rate *= scale;
+        if (config.budget > 0) {
+            config.budget = std::max(1, static_cast<int>(static_cast<float>(config.budget) * scale));
+        }
+        config.params.size *= sizeScale;
+        config.params.sizeDeviation *= sizeScale;
+    }
+    _input.maxAlive = scale < 1.0f ? _budget.maxAlive(std::max(_stats.capacity, _maxParticles)) : 0;
+    _input.dt = dt;
+    _input.camPos = camPos;
+    _input.model = battlecruiser.getModelMatrix();
+    _input.blendMode = _blendMode;
+    _input.exhaustionPolicy = _exhaustionPolicy;
+
+    _simulationRunning = true;
+    _threadPool.submit(_simulation, [this]() {
+        spawn_stage(_input.dt);
+        update_stage(_input.dt, _input.camPos);
+    });
+}
+
+void ParticleSystem::set_frame_gpu_ms(float ms) {
+    _frameGpuMs = ms;
+    _hasFrameGpuMs = true;
+}
+
+void ParticleSystem::join() {
+    if (!_simulationRunning) return;
+    auto start = std::chrono::steady_clock::now();
+    _threadPool.wait(_simulation);
+    _simulationRunning = false;
+
+    _stats.joinWaitMs = elapsedMs(start);
+    _stats.alive = _pool.aliveCount;
+    _stats.capacity = _pool.capacity;
+    _stats.growLimit = _pool.growLimit;
+    _stats.spawned = _pool.spawnedCount;
+    _stats.dropped = _pool.droppedCount;
+    _stats.recycled = _pool.recycledCount;
+    _stats.updateMs = _updateMs;
+    _stats.sortMs = _sortMs;
+    _stats.fillMs = _fillMs;
+    for (size_t id = 0; id < _emitterStates.size(); id++) {
+        _stats.emitterAlive[id] = _emitterStates[id].alive;
+    }
+}
+
+void ParticleSystem::simulate_gpu() {
+    if (!_gpu) {
+        _gpu = std::make_unique<GpuParticles>(_gpuCapacity);
+    }
+
+    // Spawn parameters can be edited at runtime, so refresh them every frame
+    float maxLife = 1e-3f;
+    for (size_t i = 0; i < _gpuEmitters.size(); ++i) {
+        const ParticleSpawnParams &params = _emitterConfigs[_gpuEmitterIds[i]].params;
+        _gpuEmitters[i].params = params;
+        maxLife = std::max(maxLife, params.life + params.lifeDeviation);
+    }
+    float spawn = _gpuSpawnRate * _budget.getScale() * _gpuPendingDt * static_cast<float>(_gpuEmitters.size());
+    // The alive count stays on the GPU, but no particle outlives the longest
+    // life + lifeDeviation, so spawning at most maxAlive per that time caps it
+    _gpuMaxAlive = _budget.getScale() < 1.0f ? _budget.maxAlive(_gpuCapacity) : 0;
+    if (_gpuMaxAlive > 0) {
+        spawn = std::min(spawn, static_cast<float>(_gpuMaxAlive) * _gpuPendingDt / maxLife);
+    }
+    spawn += _gpuSpawnCarry;
+    int spawnCount = static_cast<int>(spawn);
+    _gpuSpawnCarry = spawn - static_cast<float>(spawnCount);
+
+    _gpu->simulate(_gpuPendingDt, battlecruiser.getModelMatrix(), _gpuEmitters, spawnCount, _budget.sizeScale(),
+                   maxLife);
+    _gpuPendingDt = 0.0f;
+}
+
+
+void ParticleSystem::imgui() {
+    ImGui::Separator();
+    ImGui::Text("Thruster Particles");
+    int backend = static_cast<int>(_backend);
+    const char *backends[] = {"CPU", "GPU (transform feedback)"};
+    if (ImGui::Combo("Particle Backend", &backend, backends, IM_ARRAYSIZE(backends))) {
+        _backend = static_cast<ParticleBackend>(backend);
+    }
+    ImGui::Checkbox("Adaptive Particle Budget", &_budget.adaptive);
+    ImGui::SliderFloat("Target GPU Frame Time (ms)", &_budget.targetFrameMs, 4.0f, 50.0f, "%.1f");
+    ImGui::Text("GPU frame %.2f ms (smoothed), budget %.0f%% (%s)",
+                static_cast<double>(_budget.getSmoothedMs()),
+                static_cast<double>(_budget.getScale() * 100.0f),
+                ParticleBudget::stateName(_budget.getState()));
+    const int maxAlive = _backend == ParticleBackend::GPU ? _gpuMaxAlive : _input.maxAlive;
+    if (maxAlive > 0) {
+        ImGui::Text("Max alive %d, size x%.2f", maxAlive, static_cast<double>(_budget.sizeScale()));
+    }
+    if (_backend == ParticleBackend::GPU) {
+        ImGui::SliderFloat("GPU Spawn Rate (per thruster/s)", &_gpuSpawnRate, 100.0f, 500000.0f,
+                           "%.0f", ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("GPU slots: %d of %d live (drawn unsorted)", _gpu ? _gpu->getLiveSlots() : 0, _gpuCapacity);
+        return;
+    }
+    int blendMode = static_cast<int>(_blendMode);
+    const char *blendModes[] = {"Alpha (sorted)", "Additive (unsorted)", "Weighted blended OIT"};
+    if (ImGui::Combo("Particle Blending", &blendMode, blendModes, IM_ARRAYSIZE(blendModes))) {
+        _blendMode = static_cast<ParticleBlendMode>(blendMode);
+    }
+    if (ImGui::CollapsingHeader("Particle Blend Timings")) {
+        if (_compareFramesLeft > 0) {
+            ImGui::Text("Comparing... %s", blendModes[static_cast<int>(_blendMode)]);
+        } else if (ImGui::Button("Compare Blend Modes")) {
+            _blendModeBeforeCompare = _blendMode;
+            _blendMode = static_cast<ParticleBlendMode>(0);
+            _compareFramesLeft = COMPARE_FRAMES_PER_MODE;
+            for (BlendTiming &timing : _blendTimings) timing = BlendTiming{};
+        }
+        if (ImGui::BeginTable("blend_timings", 4, ImGuiTableFlags_Borders)) {
+            ImGui::TableSetupColumn("Mode");
+            ImGui::TableSetupColumn("Particles");
+            ImGui::TableSetupColumn("Sort (CPU ms)");
+            ImGui::TableSetupColumn("Draw (GPU ms)");
+            ImGui::TableHeadersRow();
+            for (int m = 0; m < PARTICLE_BLEND_MODE_COUNT; m++) {
+                const BlendTiming &timing = _blendTimings[m];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(blendModes[m]);
+                ImGui::TableNextColumn();
+                if (timing.samples == 0) {
+                    ImGui::TextUnformatted("-");
+                    ImGui::TableNextColumn();
+                    ImGui::TableNextColumn();
+                    continue;
+                }
+                ImGui::Text("%d", timing.alive);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", static_cast<double>(timing.sortMs));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", static_cast<double>(timing.drawMs));
+            }
+            ImGui::EndTable();
+        }
+    }
+    if (ImGui::CollapsingHeader("Particle Emitters")) {
+        for (size_t id = 0; id < _emitterConfigs.size(); id++) {
+            EmitterConfig &emitter = _emitterConfigs[id];
+            ImGui::PushID(static_cast<int>(id));
+            if (ImGui::TreeNode(emitter.name.c_str())) {
+                ImGui::Text("Alive: %d, positions: %d", _stats.emitterAlive[id],
+                            static_cast<int>(emitter.positions.size()));
+                ImGui::SliderFloat("Rate (per position/s)", &emitter.rate, 0.0f, 20000.0f, "%.0f",
+                                   ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderInt("Budget (0 = none)", &emitter.budget, 0, _stats.growLimit);
+                ImGui::SliderFloat("Life", &emitter.params.life, 0.05f, 5.0f);
+                ImGui::SliderFloat("Fade Out", &emitter.params.fadeOut, 0.01f, 5.0f);
+                ImGui::SliderFloat("Size", &emitter.params.size, 0.001f, 0.5f);
+                ImGui::SliderFloat("Size Growth", &emitter.params.sizeGrowth, -0.2f, 0.2f);
+                ImGui::TreePop();
+            }
+            ImGui::PopID();
+        }
+    }
+    int policy = static_cast<int>(_exhaustionPolicy);
+    const char *policies[] = {"Drop new", "Recycle oldest", "Grow pool"};
+    if (ImGui::Combo("When Pool Is Full", &policy, policies, IM_ARRAYSIZE(policies))) {
+        _exhaustionPolicy = static_cast<ParticleExhaustionPolicy>(policy);
+    }
+    if (ImGui::InputInt("Spawn Seed", &_seed)) {
+        reseed(static_cast<uint32_t>(_seed));
+    }
+    ImGui::Text("Alive: %d / %d (grows up to %d), kernel: %s", _stats.alive,
+                _stats.capacity, _stats.growLimit, particleKernelName(_kernel));
+    ImGui::Text("Spawned %llu, dropped %llu, recycled %llu",
+                (unsigned long long) _stats.spawned,
+                (unsigned long long) _stats.dropped,
+                (unsigned long long) _stats.recycled);
+    ImGui::Checkbox("Simulate One Frame Ahead", &_simulateAhead);
+    ImGui::Text("CPU (%d threads): update %.3f ms, sort %.3f ms, fill %.3f ms",
+                _threadPool.get_thread_count() + 1, static_cast<double>(_stats.updateMs),
+                static_cast<double>(_stats.sortMs), static_cast<double>(_stats.fillMs));
+    ImGui::Text("Main thread waited %.3f ms for the simulation", static_cast<double>(_stats.joinWaitMs));
+    int uploadMode = static_cast<int>(_instanceRing.get_mode());
+    const char *uploadModes[] = {"glBufferSubData", "Orphaning", "Fenced ring"};
+    if (ImGui::Combo("Instance Upload", &uploadMode, uploadModes, IM_ARRAYSIZE(uploadModes))) {
+        _instanceRing.set_mode(static_cast<UploadRing::Mode>(uploadMode));
+    }
+    ImGui::Text("Upload: %.3f ms (%.3f ms waiting on GPU)",
+                static_cast<double>(_instanceRing.get_upload_ms()),
+                static_cast<double>(_instanceRing.get_wait_ms()));
 }
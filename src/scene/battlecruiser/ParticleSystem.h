@@ -1,68 +1,208 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <memory>
+#include <string>
 #include <vector>
 #include <glad/glad.h>
 #include <framework/shader.h>
 
 #include "Battlecruiser.h"
+#include "core/config.h"
+#include "core/GpuTimer.h"
+#include "core/OcclusionCuller.h"
+#include "core/ThreadPool.h"
+#include "core/UploadRing.h"
+#include "core/WeightedOIT.h"
+#include "GpuParticles.h"
+#include "ParticleBudget.h"
+#include "ParticleKernels.h"
+#include "ParticlePool.h"
+#include "ParticleSpawner.h"
 
-struct Particle {
-    glm::vec3 pos;
-    glm::vec3 speed;
-    unsigned char r, g, b, a;
-    float size;
-    float life;
-    float cameraDistance;
-
-    bool operator<(const Particle& that) const {
-        return cameraDistance > that.cameraDistance;
-    }
+// How particles are composited. Alpha blending needs back-to-front order;
+// additive blending and weighted blended OIT are order independent and skip
+// the depth sort.
+enum class ParticleBlendMode { AlphaSorted, Additive, WeightedOIT };
+constexpr int PARTICLE_BLEND_MODE_COUNT = 3;
+
+// Where particles are simulated. The GPU backend keeps all state in GPU
+// buffers (see GpuParticles) and is drawn without depth sorting.
+enum class ParticleBackend { CPU, GPU };
+
+// Per-instance vertex data of one billboard, see particle_vertex.glsl
+struct ParticleInstance {
+    GLfloat x, y, z, size;
+    GLubyte r, g, b, a;
 };
 
 class ParticleSystem {
     Battlecruiser& battlecruiser;
 public:
-    explicit ParticleSystem(Battlecruiser& battlecruiser, int maxParticles = 100000);
+    // Emitters come from config.emitters; without any, every thruster of the
+    // battlecruiser gets the default ParticleSpawnParams. The CPU simulation
+    // runs on threadPool.
+    ParticleSystem(Battlecruiser& battlecruiser, const Config& config, ThreadPool& threadPool);
     ~ParticleSystem();
 
-    void spawn_stage(float dt);
-    void update_stage(float dt, const glm::vec3& camPos);
-    void draw_stage(const glm::mat4& view, const glm::mat4& projection);
+    // Starts simulating the frame on the thread pool and returns. The result
+    // is joined in draw_stage, or with simulate-ahead on, in the next update
+    // while this frame draws the previous result.
     void update(const glm::vec3& camPos, float dt);
+    // With `occlusion`, skips drawing while the particles' bounding box is
+    // hidden (CPU backend only, the GPU one has no bounds on the CPU).
+    // framebufferSize is the size of the default framebuffer, for the OIT
+    // targets.
+    void draw_stage(const glm::mat4& view, const glm::mat4& projection,
+                    const glm::ivec2& framebufferSize, OcclusionCuller* occlusion = nullptr);
+    void imgui();
 
-private:
-    void spawn_per_location(const glm::vec3& origin);
+    // GPU time of the last measured frame, drives the adaptive budget
+    void set_frame_gpu_ms(float ms);
 
-    int findUnusedParticle();
+    // Restarts the spawn random stream (from the next update on), for
+    // reproducible runs
+    void reseed(uint32_t seed);
+
+private:
+    // Stages of the simulation job, see update()
+    void spawn_stage(float dt);
+    void update_stage(float dt, const glm::vec3& camPos);
+    // Spawns `count` particles from the emitter in one batch
+    void spawn(const ParticleEmitter& emitter, const ParticleSpawnParams& params, int count);
+    void sort_stage();
+    // Waits for the running simulation and publishes its results
+    void join();
+    void simulate_gpu();
+    void draw_instances();
+    void record_blend_timings(ParticleBlendMode mode);
 
     int _maxParticles;
-    int _lastUsedParticle;
-    int _aliveCount;
-    std::vector<Particle> _particles;
+    ThreadPool& _threadPool;
+
+    // Everything below up to the GPU backend belongs to the simulation job
+    // while it runs; the main thread only touches it after join().
+    ParticlePool _pool;
+    ParticleKernel _kernel;
+    std::vector<int> _drawOrder;  // alive particle indices, back to front
+    ParticleBlendMode _blendMode = ParticleBlendMode::AlphaSorted;
+    ParticleExhaustionPolicy _exhaustionPolicy = ParticleExhaustionPolicy::Drop;
+    std::vector<int> _spawnSlots;
+
+    std::vector<float> _spawnRandom;  // random numbers of one batch
+    ParticleRng _rng;
+
+    // radix sort scratch
+    std::vector<uint16_t> _sortKeys;
+    std::vector<int> _sortScratch;
+
+    // A configured emitter, edited in the UI
+    struct EmitterConfig {
+        std::string name;
+        std::vector<glm::vec3> positions;  // model space
+        ParticleSpawnParams params;
+        float rate = 1000.0f;
+        int maxPerFrame = 500;
+        int burst = 0;
+        float burstInterval = 0.0f;
+        int budget = 0;
+    };
+    // The simulation's copy of an emitter and its spawn bookkeeping
+    struct EmitterState {
+        EmitterConfig config;  // copied from _emitterConfigs per update
+        float rateCarry = 0.0f;  // fraction of a particle left from last frame
+        float burstTimer = 0.0f;
+        int alive = 0;
+    };
+    static constexpr int MAX_EMITTERS = 256;  // ids are stored as uint8_t
+    std::vector<EmitterState> _emitterStates;
+
+    // Inputs of the running simulation, set before it starts
+    struct SimulationInput {
+        float dt = 0.0f;
+        glm::vec3 camPos{0.0f};
+        glm::mat4 model{1.0f};
+        ParticleBlendMode blendMode = ParticleBlendMode::AlphaSorted;
+        ParticleExhaustionPolicy exhaustionPolicy = ParticleExhaustionPolicy::Drop;
+        int maxAlive = 0;  // no spawning above this (from the budget), 0 = no limit
+    };
+    SimulationInput _input;
+
+    // Instance data written by the simulation. With simulate-ahead on, the
+    // job fills one buffer while the other is drawn.
+    std::vector<ParticleInstance> _instanceData[2];
+    int _instanceCount[2] = {0, 0};
+    // World space box around the billboards of each buffer
+    glm::vec3 _instanceBoundsMin[2] = {};
+    glm::vec3 _instanceBoundsMax[2] = {};
+    int _writeBuffer = 0;
+    int _readBuffer = 0;
+
+    // CPU timings of the last simulation, in ms
+    float _updateMs = 0.0f;
+    float _sortMs = 0.0f;
+    float _fillMs = 0.0f;
+
+    ThreadPool::TaskGroup _simulation;
+    bool _simulationRunning = false;
+    bool _simulateAhead = false;
+
+    // Main thread side: settings applied when the next simulation starts and
+    // results published by join()
+    std::vector<EmitterConfig> _emitterConfigs;
+    std::vector<GpuParticles::Emitter> _gpuEmitters;  // one per emitter position, for the GPU backend
+    std::vector<size_t> _gpuEmitterIds;                // _emitterConfigs index of each GPU emitter
+    int _seed = 1;
+    bool _reseedPending = false;
+    ParticleBudget _budget;
+    float _frameGpuMs = 0.0f;
+    bool _hasFrameGpuMs = false;
+
+    struct SimulationStats {
+        int alive = 0;
+        int capacity = 0;
+        int growLimit = 0;
+        uint64_t spawned = 0;
+        uint64_t dropped = 0;
+        uint64_t recycled = 0;
+        float updateMs = 0.0f;
+        float sortMs = 0.0f;
+        float fillMs = 0.0f;
+        float joinWaitMs = 0.0f;  // main thread blocked on the simulation
+        std::vector<int> emitterAlive;
+    };
+    SimulationStats _stats;
+
+    ParticleBackend _backend = ParticleBackend::CPU;
+    std::unique_ptr<GpuParticles> _gpu;  // created on first use
+    int _gpuCapacity = 1 << 20;
+    float _gpuSpawnRate = 1000.0f;
+    float _gpuSpawnCarry = 0.0f;
+    int _gpuMaxAlive = 0;  // budget's cap on the GPU backend, 0 = none
+    float _gpuPendingDt = 0.0f;
+
+    std::unique_ptr<WeightedOIT> _oit;  // created on first use
+    Shader _oitShader;
+
+    // Per blend mode cost, for the comparison table
+    struct BlendTiming {
+        float sortMs = 0.0f;
+        float drawMs = 0.0f;
+        int alive = 0;
+        int samples = 0;
+    };
+    static constexpr int COMPARE_FRAMES_PER_MODE = 120;
+    BlendTiming _blendTimings[PARTICLE_BLEND_MODE_COUNT];
+    GpuTimer _drawTimer;
+    ParticleBlendMode _lastDrawnMode = ParticleBlendMode::AlphaSorted;
+    ParticleBlendMode _blendModeBeforeCompare = ParticleBlendMode::AlphaSorted;
+    int _framesInMode = 0;
+    int _compareFramesLeft = 0;
 
     GLuint _vao = 0;
     GLuint _vboBillboard = 0;
-    GLuint _vboPositions = 0;
-    GLuint _vboColors = 0;
+    UploadRing _instanceRing;
 
     Shader shader;
 
-    std::vector<GLfloat> _posSizeData;
-    std::vector<GLubyte> _colorData;
-
-    glm::vec3 speedInitParticle = glm::vec3(0.0f, 0.0f, 0.0f);
-    glm::vec2 colorR = glm::vec2(233.0f, 255.f);
-    glm::vec2 colorG = glm::vec2(165.0f, 255.f);
-    glm::vec2 colorB = glm::vec2(0.0f, 0.0f);
-    
-    float life = 1.0f;
-    float lifeDeviation = 0.5f;
-    float lifeThreshold = 0.5f;
-    float size = 0.06f;
-    float sizeDeviation = 0.06f;
-
-    float spawnRadius = 0.2f;    
     float coneAngleDeviation = 5.0f;
-    float coneAngle = 30.0f;
-    float velocitySpread = 0.2f;
 };
@@ -0,0 +1,516 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+#include <framework/shader.h>
+
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+#include <imgui/imgui.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+DISABLE_WARNINGS_POP()
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "core/Frustum.h"
+#include "core/ThreadPool.h"
+#include "core/UploadRing.h"
+#include "core/config.h"
+#include "scene/bodies/ico_mesh.h"
+
+// Rounds to the nearest integer with the 1.5 * 2^23 trick instead of a libm
+// call, so loops using it vectorize on plain SSE2. Valid for |x| < 2^22.
+inline float belt_round(float x) {
+    const float magic = 12582912.0f;
+    return (x + magic) - magic;
+}
+
+// Branch-free sine approximation, accurate to ~6e-6 for |x| < 2^22.
+// Uses min/max instead of branches so loops over it auto-vectorize.
+inline float belt_fast_sin(float x) {
+    const float two_pi = glm::two_pi<float>();
+    const float pi = glm::pi<float>();
+    // reduce to [-pi, pi]
+    x = x - two_pi * belt_round(x * (1.0f / two_pi));
+    // fold to [-pi/2, pi/2]
+    x = std::min(x, pi - x);
+    x = std::max(x, -pi - x);
+    float x2 = x * x;
+    return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f +
+                x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f)))));
+}
+
+// A procedurally generated belt of asteroids orbiting a parent body.
+//
+// Asteroids are stored as a structure of arrays and advanced with plain,
+// branch-free loops that the compiler vectorizes. Every frame each asteroid is
+// frustum culled and assigned a level of detail from its projected size:
+//  - MESH:     close asteroids, an instanced low-poly rock
+//  - IMPOSTOR: a camera-facing quad shaded as a lumpy sphere
+//  - POINT:    a single GL point, for everything that is a few pixels or less
+// Each level is rendered with one instanced draw call.
+//
+// The orbit update and the classification run in fixed chunks on the thread
+// pool. The instances of all levels are packed into one array, streamed
+// through an UploadRing once per frame.
+class AsteroidBelt {
+   public:
+    enum Lod : uint8_t { CULLED = 0, POINT, IMPOSTOR, MESH, LOD_COUNT };
+
+    AsteroidBelt(const Config::BeltInfo& belt_info, ThreadPool& pool)
+        : info(belt_info),
+          thread_pool(pool),
+          instance_ring(GL_ARRAY_BUFFER,
+                        (size_t)std::max(belt_info.count, 1) * sizeof(glm::vec4)) {
+        generate();
+        setup_gl();
+    }
+
+    AsteroidBelt(const AsteroidBelt&) = delete;
+    AsteroidBelt& operator=(const AsteroidBelt&) = delete;
+
+    ~AsteroidBelt() {
+        glDeleteVertexArrays(LOD_COUNT, vaos);
+        glDeleteBuffers(1, &rock_vbo);
+        glDeleteBuffers(1, &rock_ibo);
+        glDeleteBuffers(1, &quad_vbo);
+    }
+
+    int get_parent_id() const { return info.parent_id; }
+    size_t size() const { return orbit_radius.size(); }
+
+    // Advances all orbits by `delta_time` around `center`.
+    void update(float delta_time, const glm::vec3& center) {
+        auto start = std::chrono::steady_clock::now();
+        thread_pool.parallel_for((int)size(), CHUNK_SIZE, [&](int first, int last) {
+            const size_t i = (size_t)first;
+            advance_orbits((size_t)(last - first), orbit_angle.data() + i,
+                           angular_speed.data() + i, orbit_radius.data() + i,
+                           orbit_height.data() + i, pos_x.data() + i,
+                           pos_y.data() + i, pos_z.data() + i, delta_time,
+                           center, plane_u, plane_v, plane_normal);
+        });
+        update_ms = elapsed_ms(start);
+    }
+
+    void imgui() {
+        ImGui::Text("Belt: %d asteroids around body %d", (int)size(),
+                    info.parent_id);
+        ImGui::Text("  mesh %d, impostor %d, point %d, culled %d",
+                    lod_counts[MESH], lod_counts[IMPOSTOR], lod_counts[POINT],
+                    lod_counts[CULLED]);
+        ImGui::Text("  update %.2f ms, LOD selection %.2f ms, upload %.2f ms",
+                    (double)update_ms, (double)classify_ms,
+                    (double)instance_ring.get_upload_ms());
+    }
+
+    // Thresholds are projected diameters in pixels
+    static inline float mesh_pixel_size = 24.0f;
+    static inline float impostor_pixel_size = 3.0f;
+    static inline int max_mesh_instances = 4096;
+
+    static void imgui_lod_controls() {
+        ImGui::DragFloat("Belt Mesh LOD Pixel Size", &mesh_pixel_size, 0.5f,
+                         1.0f, 256.0f);
+        ImGui::DragFloat("Belt Impostor LOD Pixel Size", &impostor_pixel_size,
+                         0.1f, 0.0f, 64.0f);
+        ImGui::DragInt("Belt Max Mesh Instances", &max_mesh_instances, 16, 0,
+                       65536);
+    }
+
+    // Returns the number of draw calls issued.
+    int draw(const glm::mat4& view_matrix, const glm::mat4& projection_matrix,
+             const glm::vec3& camera_position, float fov_radians,
+             float screen_height, const glm::vec3& light_position) {
+        float pixel_scale = screen_height / (2.0f * glm::tan(fov_radians / 2.0f));
+        classify(Frustum(projection_matrix * view_matrix), camera_position,
+                 pixel_scale);
+        if (instances.empty()) return 0;
+
+        const size_t base = instance_ring.upload(
+            instances.data(), instances.size() * sizeof(glm::vec4));
+        const GLuint buffer = instance_ring.get_buffer();
+
+        int draw_calls = 0;
+        for (int level = POINT; level < LOD_COUNT; level++) {
+            const size_t first = lod_offsets[level];
+            GLsizei count = (GLsizei)(lod_offsets[level + 1] - first);
+            if (count == 0) continue;
+
+            const Shader& shader = shaders[level];
+            shader.bind();
+            glUniformMatrix4fv(shader.getUniformLocation("view"), 1, GL_FALSE,
+                               glm::value_ptr(view_matrix));
+            glUniformMatrix4fv(shader.getUniformLocation("projection"), 1,
+                               GL_FALSE, glm::value_ptr(projection_matrix));
+            glUniform3fv(shader.getUniformLocation("cameraWorldPos"), 1,
+                         glm::value_ptr(camera_position));
+            glUniform3fv(shader.getUniformLocation("lightPosition"), 1,
+                         glm::value_ptr(light_position));
+            glUniform1f(shader.getUniformLocation("pixelScale"), pixel_scale);
+
+            // no base instance in GL 4.1, so the pointer carries the offset
+            glBindVertexArray(vaos[level]);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glVertexAttribPointer(
+                3, 4, GL_FLOAT, GL_FALSE, 0,
+                (void*)(base + first * sizeof(glm::vec4)));
+            switch (level) {
+                case POINT:
+                    glEnable(GL_PROGRAM_POINT_SIZE);
+                    glDrawArrays(GL_POINTS, 0, count);
+                    glDisable(GL_PROGRAM_POINT_SIZE);
+                    break;
+                case IMPOSTOR:
+                    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+                    break;
+                case MESH:
+                    glDrawElementsInstanced(GL_TRIANGLES, rock_index_count,
+                                            GL_UNSIGNED_INT, nullptr, count);
+                    break;
+            }
+            draw_calls++;
+        }
+        instance_ring.fence();
+        glBindVertexArray(0);
+        return draw_calls;
+    }
+
+   private:
+    // Orbit update kernel. Kept as a free-standing loop over restrict
+    // pointers without branches or libm calls so the compiler vectorizes it
+    // (4 or 8 asteroids per iteration with SSE2 / AVX2). Angles are kept in
+    // [-pi, pi] for precision.
+    static void advance_orbits(size_t n, float* __restrict angle,
+                               const float* __restrict speed,
+                               const float* __restrict radius,
+                               const float* __restrict height,
+                               float* __restrict px, float* __restrict py,
+                               float* __restrict pz, float delta_time,
+                               glm::vec3 center, glm::vec3 u, glm::vec3 v,
+                               glm::vec3 w) {
+        const float two_pi = glm::two_pi<float>();
+        const float half_pi = glm::half_pi<float>();
+        for (size_t i = 0; i < n; i++) {
+            float a = angle[i] + speed[i] * delta_time;
+            a -= two_pi * belt_round(a * (1.0f / two_pi));
+            angle[i] = a;
+
+            float c = radius[i] * belt_fast_sin(a + half_pi);
+            float s = radius[i] * belt_fast_sin(a);
+            px[i] = center.x + c * u.x + s * v.x + height[i] * w.x;
+            py[i] = center.y + c * u.y + s * v.y + height[i] * w.y;
+            pz[i] = center.z + c * u.z + s * v.z + height[i] * w.z;
+        }
+    }
+
+    static float elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    void generate() {
+        const size_t n = (size_t)std::max(info.count, 0);
+        orbit_radius.resize(n);
+        orbit_angle.resize(n);
+        angular_speed.resize(n);
+        orbit_height.resize(n);
+        asteroid_size.resize(n);
+        pos_x.resize(n);
+        pos_y.resize(n);
+        pos_z.resize(n);
+        lod.resize(n);
+
+        plane_normal = glm::normalize(info.orbit_normal);
+        glm::vec3 helper = std::abs(plane_normal.y) < 0.9f
+                               ? glm::vec3(0.0f, 1.0f, 0.0f)
+                               : glm::vec3(1.0f, 0.0f, 0.0f);
+        plane_u = glm::normalize(glm::cross(helper, plane_normal));
+        plane_v = glm::cross(plane_normal, plane_u);
+
+        std::mt19937 rng(info.seed);
+        std::uniform_real_distribution<float> dist01(0.0f, 1.0f);
+        std::normal_distribution<float> dist_normal(0.0f, 1.0f);
+
+        const float inner = std::max(info.inner_radius, 1e-3f);
+        const float outer = std::max(info.outer_radius, inner);
+        const float inner_speed =
+            glm::two_pi<float>() / std::max(info.orbit_period, 1e-3f);
+        // sizes must be positive for the power law, pow(0, k < 0) is inf
+        const float min_size = std::max(info.min_size, 1e-4f);
+        const float max_size = std::max(info.max_size, min_size);
+        // inverse CDF of the truncated power law
+        const float k = 1.0f - info.size_exponent;
+        const float min_k = std::pow(min_size, k);
+        const float max_k = std::pow(max_size, k);
+
+        for (size_t i = 0; i < n; i++) {
+            // uniform density over the annulus
+            float r = std::sqrt(glm::mix(inner * inner, outer * outer, dist01(rng)));
+            orbit_radius[i] = r;
+            orbit_angle[i] = glm::two_pi<float>() * dist01(rng) - glm::pi<float>();
+            angular_speed[i] = inner_speed * std::pow(inner / r, 1.5f);
+            orbit_height[i] = 0.5f * info.thickness * dist_normal(rng);
+            if (std::abs(k) < 1e-4f) {
+                asteroid_size[i] =
+                    min_size * std::pow(max_size / min_size, dist01(rng));
+            } else {
+                asteroid_size[i] =
+                    std::pow(glm::mix(min_k, max_k, dist01(rng)), 1.0f / k);
+            }
+        }
+
+        update(0.0f, glm::vec3(0.0f));
+    }
+
+    // Frustum culls all asteroids and picks their LOD, then packs the
+    // instance data (xyz = position, w = size) of each LOD into `instances`,
+    // level after level.
+    void classify(const Frustum& frustum, const glm::vec3& camera_position,
+                  float pixel_scale) {
+        auto start = std::chrono::steady_clock::now();
+        const size_t n = size();
+        const int num_chunks = std::clamp((int)(n / CHUNK_SIZE), 1,
+                                          thread_pool.get_thread_count() + 1);
+        const size_t chunk_size = (n + (size_t)num_chunks - 1) / (size_t)num_chunks;
+        chunks.assign((size_t)num_chunks, Chunk{});
+
+        glm::vec4 planes[Frustum::PLANE_COUNT];
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            planes[p] = frustum.get_plane((Frustum::Plane)p);
+        }
+        const float mesh_threshold = mesh_pixel_size / (2.0f * pixel_scale);
+        const float impostor_threshold =
+            impostor_pixel_size / (2.0f * pixel_scale);
+
+        // Pass 1: LOD selection and per-chunk counts
+        thread_pool.parallel_for(num_chunks, 1, [&](int first, int last) {
+            for (int c = first; c < last; c++) {
+                const size_t begin = std::min((size_t)c * chunk_size, n);
+                const size_t end = std::min(begin + chunk_size, n);
+                select_lods(end - begin, pos_x.data() + begin,
+                            pos_y.data() + begin, pos_z.data() + begin,
+                            asteroid_size.data() + begin, lod.data() + begin,
+                            planes, camera_position, mesh_threshold,
+                            impostor_threshold);
+                // one compare per level and asteroid, so this vectorizes too
+                int counts[LOD_COUNT] = {};
+                for (size_t i = begin; i < end; i++) {
+                    for (int l = 0; l < LOD_COUNT; l++) counts[l] += lod[i] == l;
+                }
+                std::copy(counts, counts + LOD_COUNT, chunks[(size_t)c].counts);
+            }
+        });
+
+        // Chunks in order keep the first max_mesh_instances meshes and demote
+        // the rest to impostors. Then every chunk gets its write position
+        // within each level.
+        int mesh_budget = std::max(max_mesh_instances, 0);
+        size_t totals[LOD_COUNT] = {};
+        for (Chunk& chunk : chunks) {
+            const int kept = std::min(chunk.counts[MESH], mesh_budget);
+            mesh_budget -= kept;
+            chunk.counts[IMPOSTOR] += chunk.counts[MESH] - kept;
+            chunk.counts[MESH] = kept;
+            for (int l = 0; l < LOD_COUNT; l++) {
+                chunk.next[l] = totals[l];
+                totals[l] += (size_t)chunk.counts[l];
+            }
+        }
+        lod_offsets[CULLED] = 0;
+        lod_offsets[POINT] = 0;
+        for (int l = POINT; l < LOD_COUNT; l++) {
+            lod_offsets[l + 1] = lod_offsets[l] + totals[l];
+        }
+        instances.resize(lod_offsets[LOD_COUNT]);
+        for (Chunk& chunk : chunks) {
+            for (int l = POINT; l < LOD_COUNT; l++) chunk.next[l] += lod_offsets[l];
+        }
+
+        // Pass 2: gather into the packed array
+        thread_pool.parallel_for(num_chunks, 1, [&](int first, int last) {
+            for (int c = first; c < last; c++) {
+                const size_t begin = std::min((size_t)c * chunk_size, n);
+                const size_t end = std::min(begin + chunk_size, n);
+                Chunk& chunk = chunks[(size_t)c];
+                const size_t mesh_end = chunk.next[MESH] + (size_t)chunk.counts[MESH];
+                for (size_t i = begin; i < end; i++) {
+                    uint8_t level = lod[i];
+                    if (level == CULLED) continue;
+                    if (level == MESH && chunk.next[MESH] == mesh_end) {
+                        level = IMPOSTOR;
+                    }
+                    instances[chunk.next[level]++] =
+                        glm::vec4(pos_x[i], pos_y[i], pos_z[i], asteroid_size[i]);
+                }
+            }
+        });
+
+        for (int l = POINT; l < LOD_COUNT; l++) {
+            lod_counts[l] = (int)totals[l];
+        }
+        lod_counts[CULLED] = (int)totals[CULLED];
+
+        classify_ms = elapsed_ms(start);
+    }
+
+    // LOD selection kernel, branch-free so it vectorizes
+    static void select_lods(size_t n, const float* __restrict px,
+                            const float* __restrict py,
+                            const float* __restrict pz,
+                            const float* __restrict sz,
+                            uint8_t* __restrict out,
+                            const glm::vec4 (&planes)[Frustum::PLANE_COUNT],
+                            glm::vec3 camera_position, float mesh_threshold,
+                            float impostor_threshold) {
+        const float mesh_threshold2 = mesh_threshold * mesh_threshold;
+        const float impostor_threshold2 = impostor_threshold * impostor_threshold;
+        for (size_t i = 0; i < n; i++) {
+            float min_dist = 1e30f;
+            for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+                float d = planes[p].x * px[i] + planes[p].y * py[i] +
+                          planes[p].z * pz[i] + planes[p].w + sz[i];
+                min_dist = std::min(min_dist, d);
+            }
+            float dx = px[i] - camera_position.x;
+            float dy = py[i] - camera_position.y;
+            float dz = pz[i] - camera_position.z;
+            float dist2 = dx * dx + dy * dy + dz * dz;
+            // size / dist compared against the thresholds, squared: a
+            // division or a sqrt (which sets errno) would stop vectorization,
+            // and so would selecting the level with branches
+            float size2 = sz[i] * sz[i];
+            int mesh = size2 > mesh_threshold2 * dist2;
+            int impostor = (size2 > impostor_threshold2 * dist2) | mesh;
+            int visible = min_dist >= 0.0f;
+            out[i] = (uint8_t)(visible * (POINT + impostor + mesh));
+        }
+    }
+
+    void setup_gl() {
+        try {
+            shaders[POINT] =
+                ShaderBuilder()
+                    .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                              "shaders/bodies/asteroid_point_vert.glsl")
+                    .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
+                              "shaders/bodies/asteroid_point_frag.glsl")
+                    .build();
+            shaders[IMPOSTOR] =
+                ShaderBuilder()
+                    .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                              "shaders/bodies/asteroid_impostor_vert.glsl")
+                    .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
+                              "shaders/bodies/asteroid_impostor_frag.glsl")
+                    .build();
+            shaders[MESH] =
+                ShaderBuilder()
+                    .addStage(GL_VERTEX_SHADER, RESOURCE_ROOT
+                              "shaders/bodies/asteroid_mesh_vert.glsl")
+                    .addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT
+                              "shaders/bodies/asteroid_mesh_frag.glsl")
+                    .build();
+        } catch (const ShaderLoadingException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        glGenVertexArrays(LOD_COUNT, vaos);
+        const GLuint instance_buffer = instance_ring.get_buffer();
+
+        // Points: the instance data is the vertex data
+        glBindVertexArray(vaos[POINT]);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+        // Impostors: billboard quad + per-instance data
+        static const GLfloat quadVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f,
+                                               -1.0f, 1.0f,  1.0f, 1.0f};
+        glBindVertexArray(vaos[IMPOSTOR]);
+        glGenBuffers(1, &quad_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices,
+                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glVertexAttribDivisor(3, 1);
+
+        // Meshes: low-poly icosphere (displaced in the shader) + instance data
+        Mesh rock = generate_ico_mesh(2);
+        glBindVertexArray(vaos[MESH]);
+        glGenBuffers(1, &rock_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, rock_vbo);
+        glBufferData(GL_ARRAY_BUFFER,
+                     (GLsizeiptr)(rock.vertices.size() * sizeof(Vertex)),
+                     rock.vertices.data(), GL_STATIC_DRAW);
+        glGenBuffers(1, &rock_ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rock_ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     (GLsizeiptr)(rock.triangles.size() * sizeof(glm::uvec3)),
+                     rock.triangles.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (void*)offsetof(Vertex, position));
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+        glVertexAttribDivisor(3, 1);
+        rock_index_count = (GLsizei)(rock.triangles.size() * 3);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Asteroids per parallel_for job
+    static constexpr int CHUNK_SIZE = 16384;
+
+    // One slice of the asteroids in classify()
+    struct Chunk {
+        int counts[LOD_COUNT] = {};    // asteroids per level
+        size_t next[LOD_COUNT] = {};  // write position per level
+    };
+
+    Config::BeltInfo info;
+    ThreadPool& thread_pool;
+
+    // Orbital plane basis
+    glm::vec3 plane_u{1.0f, 0.0f, 0.0f};
+    glm::vec3 plane_v{0.0f, 0.0f, 1.0f};
+    glm::vec3 plane_normal{0.0f, 1.0f, 0.0f};
+
+    // Per-asteroid data (structure of arrays)
+    std::vector<float> orbit_radius;
+    std::vector<float> orbit_angle;
+    std::vector<float> angular_speed;
+    std::vector<float> orbit_height;
+    std::vector<float> asteroid_size;
+    std::vector<float> pos_x, pos_y, pos_z;
+    std::vector<uint8_t> lod;
+
+    std::vector<Chunk> chunks;
+    std::vector<glm::vec4> instances;      // POINT, then IMPOSTOR, then MESH
+    size_t lod_offsets[LOD_COUNT + 1] = {};  // first instance of each level
+    int lod_counts[LOD_COUNT] = {};
+    float update_ms = 0.0f;
+    float classify_ms = 0.0f;
+
+    Shader shaders[LOD_COUNT];
+    GLuint vaos[LOD_COUNT] = {};
+    UploadRing instance_ring;
+    GLuint quad_vbo = 0;
+    GLuint rock_vbo = 0;
+    GLuint rock_ibo = 0;
+    GLsizei rock_index_count = 0;
+};
@@ -13,6 +13,7 @@ DISABLE_WARNINGS_POP()
 #include "core/ShadowMap.h"
 #include "core/config.h"
 #include "core/mesh.h"
+#include "scene/Transform.h"
 
 // This is a planet / star / space body base class with primitive default
 // behavior.
@@ -27,14 +28,32 @@ class Body {
     Body(Config& config, const glm::vec3& pos, float r,
          GPUMesh& icosahedron_mesh)
         : config(config),
-          position(pos),
           radius(r),
           icosahedronMesh(icosahedron_mesh),
-          shadow_map(config) {}
+          shadow_map(config) {
+        transform.set_local_position(pos);
+    }
 
-    glm::vec3 getPosition() const { return position; }
+    glm::vec3 getPosition() const { return transform.get_world_position(); }
     float getRadius() const { return radius; }
 
+    // Radius of a sphere around the body that contains all of its geometry,
+    // including any terrain displacement applied in the shaders.
+    virtual float get_bounding_radius() const { return radius; }
+
+    // Distance from the center to the drawn surface along a unit direction.
+    // Bodies don't rotate, so world and model space directions are the same.
+    virtual float get_surface_radius(const glm::vec3& direction) const {
+        return radius;
+    }
+
+    // Plain bodies all share the ico shader and are drawn together by
+    // BodyBatch; subclasses with their own shaders return false.
+    virtual bool is_batchable() const { return true; }
+
+    // Per-instance shader parameters (rgb = color, a = test), see ico_vert.glsl
+    glm::vec4 get_instance_params() const { return glm::vec4(color, test); }
+
     virtual void setup() {
         try {
             ShaderBuilder icoBuilder;
@@ -52,27 +71,20 @@ class Body {
         }
     }
 
+    // Renders procedural textures sampled by the body's own shader. Called
+    // once per frame for visible bodies, before any of them is drawn; it may
+    // change the bound framebuffer and viewport.
+    virtual void update_textures(float time) {}
+
     virtual void update(float deltaTime,
                         glm::vec3 p_light_position = glm::vec3(0.0f)) {
-        // Update light matrices for shadow mapping
         light_position = p_light_position;
-        light_view_matrix =
-            glm::lookAt(light_position, position, glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::vec3 centerLS =
-            glm::vec3(light_view_matrix * glm::vec4(position, 1.0f));
-        float near_plane = std::max(0.1f, -centerLS.z - radius * 2.0f);
-        // near_plane = 0.1f;
-        float far_plane = -centerLS.z + radius * 2.0f;
-        // far_plane = 100.0f;
-
-        light_projection_matrix =
-            glm::ortho(-radius * 2.0f, radius * 2.0f, -radius * 2.0f,
-                       radius * 2.0f, near_plane, far_plane);
 
         // Update body state based on deltaTime
         if (parent == nullptr) {
-            position = glm::vec3(0.0f);  // no orbiting if no parent
-            return;                      // no orbiting if no parent
+            // no orbiting if no parent
+            transform.set_local_position(glm::vec3(0.0f));
+            return;
         }
         // Focal distance: distance from ellipse center to focus (parent)
         float focalDistance =
@@ -84,7 +96,7 @@ class Body {
             glm::normalize(glm::cross(orbitNormal, majorAxis));
 
         // The ellipse center is offset from the parent along orbit_direction
-        glm::vec3 center = parent->getPosition() + focalDistance * majorAxis;
+        glm::vec3 center = focalDistance * majorAxis;
 
         // Advance orbit angle at constant angular speed
         float angularSpeed =
@@ -93,20 +105,20 @@ class Body {
         if (orbitAngle > 2.0f * glm::pi<float>())
             orbitAngle -= 2.0f * glm::pi<float>();
 
-        // Compute position on the ellipse
-        position = center + largeRadius * glm::cos(orbitAngle) * majorAxis +
-                   smallRadius * glm::sin(orbitAngle) * minorAxis;
+        // Position on the ellipse, relative to the parent: the transform
+        // hierarchy carries the body along when the parent moves
+        transform.set_local_position(
+            center + largeRadius * glm::cos(orbitAngle) * majorAxis +
+            smallRadius * glm::sin(orbitAngle) * minorAxis);
     }
 
-    glm::mat4 get_model_matrix() const {
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
-        modelMatrix = glm::translate(modelMatrix, position);
-        return modelMatrix;
-    }
+    // Cached world matrix, see Transform
+    const glm::mat4& get_model_matrix() const { return transform.get_world(); }
 
     virtual void imGuiControl() {
         ImGui::DragFloat("Planet Radius", &radius, 0.01f, 0.1f, 10.0f, "%.2f");
         ImGui::DragFloat("Test", &test, 0.01f, 0.0f, 2.00f, "%.3f");
+        ImGui::ColorEdit3("Color", glm::value_ptr(color));
         ImGui::Separator();
         ImGui::Text("Orbit Controls");
         ImGui::DragFloat3("Orbit direction",
@@ -127,21 +139,31 @@ class Body {
         }
     }
 
+    // Texture unit of the shadow map while the body is drawn
+    static constexpr GLint SHADOW_MAP_TEXTURE_UNIT = 5;
+
+    // Overrides binding textures must leave SHADOW_MAP_TEXTURE_UNIT and
+    // BodyBatch::INSTANCE_DATA_TEXTURE_UNIT alone, as well as unit 0, which
+    // ico_vert.glsl's instanceData buffer sampler points at when a body is
+    // drawn on its own.
     virtual void set_uniforms() {  // this assumes the shader is already bound
         glUniform1f(shader.getUniformLocation("radius"), radius);
         glUniform1f(shader.getUniformLocation("test"), test);
+        glUniform3fv(shader.getUniformLocation("color"), 1,
+                     glm::value_ptr(color));
     }
 
     virtual bool needs_shadow_map() { return false; }
 
     void draw_depth() {
+        update_light_matrices();
         shader.bind();
         shadow_map.bind_for_writing();
 
-        glm::mat4 modelMatrix = get_model_matrix();
-
         glUniformMatrix4fv(shader.getUniformLocation("model"), 1, GL_FALSE,
-                           glm::value_ptr(modelMatrix));
+                           glm::value_ptr(get_model_matrix()));
+        glUniform3fv(shader.getUniformLocation("planet_center"), 1,
+                     glm::value_ptr(getPosition()));
 
         glUniformMatrix4fv(shader.getUniformLocation("view"), 1, GL_FALSE,
                            glm::value_ptr(light_view_matrix));
@@ -156,10 +178,10 @@ class Body {
     void draw(
         glm::mat4 viewMatrix, glm::mat4 projectionMatrix,
         glm::vec3 cameraPos) {  // this assumes the shader is already bound
+        update_light_matrices();
         shader.bind();
-        glm::mat4 modelMatrix = get_model_matrix();
         glUniformMatrix4fv(shader.getUniformLocation("model"), 1, GL_FALSE,
-                           glm::value_ptr(modelMatrix));
+                           glm::value_ptr(get_model_matrix()));
         glUniformMatrix4fv(shader.getUniformLocation("view"), 1, GL_FALSE,
                            glm::value_ptr(viewMatrix));
         glUniformMatrix4fv(shader.getUniformLocation("projection"), 1, GL_FALSE,
@@ -167,7 +189,7 @@ class Body {
         glUniform3fv(shader.getUniformLocation("cameraWorldPos"), 1,
                      glm::value_ptr(cameraPos));
         glUniform3fv(shader.getUniformLocation("planet_center"), 1,
-                     glm::value_ptr(position));
+                     glm::value_ptr(getPosition()));
         glUniform1i(shader.getUniformLocation("only_depth"), 0);
         glUniformMatrix4fv(shader.getUniformLocation("lightViewMatrix"), 1,
                            GL_FALSE, glm::value_ptr(light_view_matrix));
@@ -177,8 +199,8 @@ class Body {
         glUniform3fv(shader.getUniformLocation("lightPosition"), 1,
                      glm::value_ptr(light_position));
 
-        shadow_map.bind_for_reading(GL_TEXTURE5);
-        glUniform1i(shader.getUniformLocation("shadowMap"), 5);
+        shadow_map.bind_for_reading(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
+        glUniform1i(shader.getUniformLocation("shadowMap"), SHADOW_MAP_TEXTURE_UNIT);
 
         set_uniforms();
 
@@ -194,6 +216,7 @@ class Body {
         largeRadius = large_r;
         orbitPeriod = period;
         parent = parent_body;
+        transform.set_parent(parent != nullptr ? &parent->transform : nullptr);
         param_orbit_direction = orbit_direction;
         param_small_radius = smallRadius;
         param_large_radius = largeRadius;
@@ -204,10 +227,39 @@ class Body {
     Shader shader;
 
    protected:
+    // Shadow-map view and projection, only rebuilt when the body or the light
+    // moved since the last call
+    void update_light_matrices() {
+        glm::vec3 position = getPosition();
+        if (light_matrices_valid && position == light_matrices_body_position &&
+            light_position == light_matrices_light_position &&
+            radius == light_matrices_radius) {
+            return;
+        }
+        light_matrices_valid = true;
+        light_matrices_body_position = position;
+        light_matrices_light_position = light_position;
+        light_matrices_radius = radius;
+
+        light_view_matrix =
+            glm::lookAt(light_position, position, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::vec3 centerLS =
+            glm::vec3(light_view_matrix * glm::vec4(position, 1.0f));
+        float near_plane = std::max(0.1f, -centerLS.z - radius * 2.0f);
+        // near_plane = 0.1f;
+        float far_plane = -centerLS.z + radius * 2.0f;
+        // far_plane = 100.0f;
+
+        light_projection_matrix =
+            glm::ortho(-radius * 2.0f, radius * 2.0f, -radius * 2.0f,
+                       radius * 2.0f, near_plane, far_plane);
+    }
+
     GPUMesh& icosahedronMesh;
-    glm::vec3 position;
+    Transform transform;  // child of the parent's transform while orbiting
     float radius;
     float test = 0.1f;
+    glm::vec3 color{0.3f, 0.3f, 1.0f};
 
     // Orbit parameters
     Body* parent = nullptr;  // the body this one orbits around
@@ -231,6 +283,11 @@ class Body {
 
     // light params
     glm::mat4 light_view_matrix;
-    glm::vec3 light_position;
+    glm::vec3 light_position{0.0f};
     glm::mat4 light_projection_matrix;
+    // inputs of the cached light matrices
+    bool light_matrices_valid = false;
+    glm::vec3 light_matrices_body_position;
+    glm::vec3 light_matrices_light_position;
+    float light_matrices_radius = 0.0f;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+#include <framework/shader.h>
+
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/vec4.hpp>
+DISABLE_WARNINGS_POP()
+#include <iostream>
+#include <vector>
+
+#include "core/UploadRing.h"
+#include "core/mesh.h"
+#include "scene/bodies/Body.h"
+
+// Draws all plain bodies with a single instanced, tessellated draw call. The
+// bodies share the ico shader and mesh; per-body data (center, radius and
+// shader parameters) lives in a buffer texture that ico_vert.glsl indexes
+// with gl_InstanceID, so the draw call count does not grow with body count.
+//
+// The buffer is streamed through an UploadRing in Orphan mode: bodies are
+// drawn several times a frame (occluders first, the environment probe faces)
+// with a few hundred bytes each, which the driver renames more cheaply than
+// a fenced ring can wait. ico_vert.glsl adds the upload offset, so the other
+// modes work too.
+class BodyBatch {
+   public:
+    static constexpr GLint INSTANCE_DATA_TEXTURE_UNIT = 6;
+    static constexpr int TEXELS_PER_INSTANCE = 2;
+
+    explicit BodyBatch(GPUMesh& icosahedron_mesh)
+        : icosahedronMesh(icosahedron_mesh),
+          instance_ring(GL_TEXTURE_BUFFER,
+                        64 * TEXELS_PER_INSTANCE * sizeof(glm::vec4)) {
+        instance_ring.set_mode(UploadRing::Mode::Orphan);
+
+        glGenTextures(1, &instance_texture);
+        glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_ring.get_buffer());
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    BodyBatch(const BodyBatch&) = delete;
+    BodyBatch& operator=(const BodyBatch&) = delete;
+
+    ~BodyBatch() {
+        glDeleteTextures(1, &instance_texture);
+    }
+
+    void setup() {
+        try {
+            ShaderBuilder icoBuilder;
+            icoBuilder.addStage(GL_VERTEX_SHADER,
+                                RESOURCE_ROOT "shaders/bodies/ico_vert.glsl");
+            icoBuilder.addStage(GL_TESS_CONTROL_SHADER,
+                                RESOURCE_ROOT "shaders/bodies/ico_tesc.glsl");
+            icoBuilder.addStage(GL_TESS_EVALUATION_SHADER,
+                                RESOURCE_ROOT "shaders/bodies/ico_tese.glsl");
+            icoBuilder.addStage(GL_FRAGMENT_SHADER,
+                                RESOURCE_ROOT "shaders/bodies/ico_frag.glsl");
+            shader = icoBuilder.build();
+        } catch (const ShaderLoadingException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Uploads the instance data of `bodies` and draws them all. Frame-wide
+    // uniforms (eclipse data, tessellation settings, ...) are expected to be
+    // set on `shader` already. Returns the number of draw calls issued.
+    int draw(const std::vector<Body*>& bodies, const glm::mat4& viewMatrix,
+             const glm::mat4& projectionMatrix, const glm::vec3& cameraPos) {
+        if (bodies.empty()) return 0;
+
+        instance_data.clear();
+        for (const Body* body : bodies) {
+            instance_data.push_back(
+                glm::vec4(body->getPosition(), body->getRadius()));
+            instance_data.push_back(body->get_instance_params());
+        }
+
+        const size_t offset = instance_ring.upload(
+            instance_data.data(), instance_data.size() * sizeof(glm::vec4));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        shader.bind();
+        glUniformMatrix4fv(shader.getUniformLocation("view"), 1, GL_FALSE,
+                           glm::value_ptr(viewMatrix));
+        glUniformMatrix4fv(shader.getUniformLocation("projection"), 1,
+                           GL_FALSE, glm::value_ptr(projectionMatrix));
+        glUniform3fv(shader.getUniformLocation("cameraWorldPos"), 1,
+                     glm::value_ptr(cameraPos));
+        glUniform1i(shader.getUniformLocation("instanced"), 1);
+        // no glTexBufferRange in GL 4.1, so the shader adds the offset
+        glUniform1i(shader.getUniformLocation("instanceDataOffset"),
+                    (GLint)(offset / sizeof(glm::vec4)));
+
+        glActiveTexture(GL_TEXTURE0 + INSTANCE_DATA_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+        glUniform1i(shader.getUniformLocation("instanceData"),
+                    INSTANCE_DATA_TEXTURE_UNIT);
+
+        icosahedronMesh.drawPatchesInstanced(shader, (GLsizei)bodies.size());
+        instance_ring.fence();
+        return 1;
+    }
+
+    Shader shader;
+
+   private:
+    GPUMesh& icosahedronMesh;
+    UploadRing instance_ring;
+    GLuint instance_texture = 0;
+    std::vector<glm::vec4> instance_data;
+};
@@ -1,11 +1,16 @@
 #pragma once
+#include <algorithm>
+
+#include "core/SimplexNoise.h"
 #include "scene/bodies/Body.h"
+#include "scene/bodies/OceanDetail.h"
 
 class Earth : public Body {
    public:
     // TODO: load earth params from config instead of insane imgui
     Earth(Config& config, const glm::vec3& pos, float r, GPUMesh& icosahedron_mesh)
-        : Body(config, pos, r, icosahedron_mesh) {}
+        : Body(config, pos, r, icosahedron_mesh),
+          ocean_detail(config.ocean_detail_resolution) {}
 
     void setup() {
         ShaderBuilder earthBuilder;
@@ -18,14 +23,53 @@ class Earth : public Body {
         earthBuilder.addStage(GL_FRAGMENT_SHADER,
                             RESOURCE_ROOT "shaders/bodies/earth_frag.glsl");
         shader = earthBuilder.build();
+        ocean_detail.setup();
+    }
+
+    // Ocean slope textures only change with the water noise parameters
+    void update_textures(float time) {
+        ocean_detail.update(water_noise_octaves, water_noise_lacunarity,
+                            water_noise_persistence);
     }
 
     void update(float deltaTime) {
         Body::update(deltaTime);
     }
 
+    bool is_batchable() const { return false; }
+
     bool needs_shadow_map() { return true; }
 
+    float get_bounding_radius() const {
+        // noise heights (and the ocean level) are in [-1, 1] and are scaled
+        // by shape_noise_scale in earth_tese.glsl
+        return radius * (1.0f + shape_noise_scale);
+    }
+
+    // Same displacement as earth_tese.glsl, the ocean flattens the low parts
+    float get_surface_radius(const glm::vec3& direction) const {
+        float height = std::max(get_height(direction), ocean_level);
+        return radius * (1.0f + height * shape_noise_scale);
+    }
+
+    // Fractal simplex noise in [-1, 1] at a point of the unit sphere, see
+    // get_height in earth_tese.glsl
+    float get_height(const glm::vec3& sphere_position) const {
+        glm::vec3 p = sphere_position * shape_noise_base_frequency +
+                      glm::vec3(shape_noise_pseudo_seed);
+        float value = 0.0f;
+        float amplitude = 1.0f;
+        float frequency = 1.0f;
+        float max_value = 0.0f;
+        for (int i = 0; i < shape_noise_octaves; i++) {
+            value += snoise(p * frequency) * amplitude;
+            max_value += amplitude;
+            amplitude *= shape_noise_persistence;
+            frequency *= shape_noise_lacunarity;
+        }
+        return value / max_value;
+    }
+
     void imGuiControl() {
         Body::imGuiControl();
         ImGui::SliderFloat("Ocean Level", &ocean_level, -1.0f, 1.0f, "%.2f");
@@ -41,6 +85,9 @@ class Earth : public Body {
         ImGui::SliderFloat("Water Noise Persistence", &water_noise_persistence, 0.0f, 1.0f, "%.2f");
         ImGui::SliderFloat("Ocean Scale", &ocean_scale, 1.0f, 100.0f, "%.2f");
         ImGui::SliderFloat("Ocean Speed", &ocean_speed, 0.0f, 5.0f, "%.2f");
+        ImGui::Text("Ocean detail: %d^2 x %d, baked %d times",
+                    ocean_detail.get_resolution(), OceanDetail::NUM_LAYERS,
+                    ocean_detail.get_num_bakes());
         ImGui::Separator();
         ImGui::SliderFloat("Water Ka", &waterKa, 0.0f, 1.0f, "%.2f");
         ImGui::SliderFloat("Water Kd", &waterKd, 0.0f, 1.0f, "%.2f");
@@ -64,11 +111,10 @@ class Earth : public Body {
         glUniform1f(shader.getUniformLocation("shape_noise_scale"),
                     shape_noise_scale);
 
-        glUniform1i(shader.getUniformLocation("OCTAVES_water"),
-                    water_noise_octaves);
-        glUniform1f(shader.getUniformLocation("LACUNARITY_water"),
-                    water_noise_lacunarity);
-        glUniform1f(shader.getUniformLocation("PERSISTENCE_water"), water_noise_persistence);
+        ocean_detail.bind_for_reading(GL_TEXTURE1);
+        glUniform1i(shader.getUniformLocation("oceanSlopes"), 1);
+        glUniform1f(shader.getUniformLocation("ocean_tile_size"),
+                    OceanDetail::TILE_SIZE);
         glUniform1f(shader.getUniformLocation("ocean_scale"),
                     ocean_scale);
         glUniform1f(shader.getUniformLocation("ocean_speed"),
@@ -102,4 +148,5 @@ class Earth : public Body {
     float waterKs = 0.9f;
     float waterShininess = 128.0f;
     float ocean_normal_gradient_multiplier = 0.01f;
+    OceanDetail ocean_detail;
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+#include <framework/shader.h>
+
+DISABLE_WARNINGS_PUSH()
+#include <glad/glad.h>
+DISABLE_WARNINGS_POP()
+#include <iostream>
+
+// Small set of tileable ocean slope textures (a 2D array, one layer per wave
+// set) baked from the water fBm once, and again whenever the water noise
+// parameters change. earth_frag.glsl scrolls the layers over the sphere with
+// time-varying offsets instead of evaluating 4D noise per fragment.
+class OceanDetail {
+   public:
+    static constexpr int NUM_LAYERS = 2;
+    // Noise units covered by one repeat of the texture
+    static constexpr float TILE_SIZE = 8.0f;
+
+    explicit OceanDetail(int layer_resolution) : resolution(layer_resolution) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG16F, resolution, resolution,
+                     NUM_LAYERS, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &fbo);
+        glGenVertexArrays(1, &empty_vao);
+    }
+
+    OceanDetail(const OceanDetail&) = delete;
+    OceanDetail& operator=(const OceanDetail&) = delete;
+
+    ~OceanDetail() {
+        glDeleteVertexArrays(1, &empty_vao);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+    }
+
+    void setup() {
+        try {
+            ShaderBuilder bakeBuilder;
+            bakeBuilder.addStage(GL_VERTEX_SHADER,
+                                 RESOURCE_ROOT "shaders/fullscreen_vert.glsl");
+            bakeBuilder.addStage(GL_FRAGMENT_SHADER,
+                                 RESOURCE_ROOT "shaders/bodies/ocean_bake_frag.glsl");
+            bake_shader = bakeBuilder.build();
+        } catch (const ShaderLoadingException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Re-bakes all layers if the water noise parameters differ from the ones
+    // last baked. Returns true if it rendered; the framebuffer and viewport
+    // are left changed in that case.
+    bool update(int octaves, float lacunarity, float persistence) {
+        if (baked && octaves == baked_octaves && lacunarity == baked_lacunarity &&
+            persistence == baked_persistence) {
+            return false;
+        }
+        baked = true;
+        baked_octaves = octaves;
+        baked_lacunarity = lacunarity;
+        baked_persistence = persistence;
+        num_bakes++;
+
+        bake_shader.bind();
+        glUniform1i(bake_shader.getUniformLocation("OCTAVES_water"), octaves);
+        glUniform1f(bake_shader.getUniformLocation("LACUNARITY_water"), lacunarity);
+        glUniform1f(bake_shader.getUniformLocation("PERSISTENCE_water"), persistence);
+        glUniform1f(bake_shader.getUniformLocation("tile_size"), TILE_SIZE);
+        glUniform1f(bake_shader.getUniformLocation("texel_size"), 1.0f / (float)resolution);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, resolution, resolution);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(empty_vao);
+        for (int layer = 0; layer < NUM_LAYERS; layer++) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                      texture, 0, layer);
+            glUniform1i(bake_shader.getUniformLocation("layer"), layer);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return true;
+    }
+
+    void bind_for_reading(GLenum texture_unit) const {
+        glActiveTexture(texture_unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    }
+
+    int get_resolution() const { return resolution; }
+    int get_num_bakes() const { return num_bakes; }
+
+   private:
+    int resolution;
+    GLuint texture = 0;
+    GLuint fbo = 0;
+    GLuint empty_vao = 0;
+    Shader bake_shader;
+
+    bool baked = false;
+    int baked_octaves = 0;
+    float baked_lacunarity = 0.0f;
+    float baked_persistence = 0.0f;
+    int num_bakes = 0;
+};
@@ -8,13 +8,21 @@ DISABLE_WARNINGS_PUSH()
 #include <imgui/imgui.h>
 DISABLE_WARNINGS_POP()
 
+#include <framework/ray.h>
+
+#include "core/Frustum.h"
+#include "core/OcclusionCuller.h"
+#include "core/ThreadPool.h"
 #include "core/config.h"
 #include "core/mesh.h"
+#include "scene/bodies/AsteroidBelt.h"
 #include "scene/bodies/Body.h"
+#include "scene/bodies/BodyBatch.h"
 #include "scene/bodies/Earth.h"
 #include "scene/bodies/Star.h"
 #include "scene/bodies/ico_mesh.h"
 
+#include <functional>
 #include <vector>
 #include <unordered_map>
 
@@ -33,11 +41,14 @@ const std::unordered_map<std::string, PlanetType> PLANET_TYPE_MAP = {
 class PlanetSystem {
    private:
     std::vector<Body*> bodies;
+    std::vector<AsteroidBelt*> belts;
     int selected_body = 0;
 
     Config& config;
+    ThreadPool& thread_pool;
     GPUMesh ico_mesh{Mesh{}};
-    
+    BodyBatch body_batch{ico_mesh};
+
     float target_body_tessellation_triangle_height = 5.0f;
     bool enable_body_tessellation = true;
     bool enable_eclipse = true;
@@ -45,8 +56,21 @@ class PlanetSystem {
     int PCF_kernel_radius = 1;
     bool enable_PCF = true;
 
+    // Culling
+    bool enable_culling = true;
+    float min_body_pixel_size = 1.0f;  // bodies smaller than this are skipped
+    // bodies covering this much of the screen height occlude the others
+    float min_occluder_screen_fraction = 0.05f;
+    std::vector<Body*> visible_bodies;
+    std::vector<float> visible_sizes;  // projected, in pixels
+    std::vector<Body*> shadow_casters;
+    int num_frustum_culled = 0;
+    int num_coverage_culled = 0;
+    int num_draw_calls = 0;
+
    public:
-    PlanetSystem(Config& config) : config(config) {
+    PlanetSystem(Config& config, ThreadPool& pool)
+        : config(config), thread_pool(pool) {
         try {
             Mesh ico_mesh_cpu =
                 generate_ico_mesh(config.planets_ico_mesh_resolution);
@@ -85,8 +109,16 @@ class PlanetSystem {
             }
         }
 
+        // batchable bodies are drawn with the shared body_batch shader
         for (auto& body : bodies) {
-            body->setup();
+            if (!body->is_batchable()) {
+                body->setup();
+            }
+        }
+        body_batch.setup();
+
+        for (const auto& belt_info : config.belts) {
+            belts.push_back(new AsteroidBelt(belt_info, thread_pool));
         }
     }
 
@@ -100,6 +132,23 @@ class PlanetSystem {
         ImGui::Checkbox("Enable Shadowmapping", &enable_shadowmapping);
         ImGui::Checkbox("Enable PCF", &enable_PCF);
         ImGui::DragInt("PCF Kernel Radius", &PCF_kernel_radius, 1, 0, 10);
+        ImGui::Checkbox("Enable Body Culling", &enable_culling);
+        ImGui::DragFloat("Min Body Pixel Size", &min_body_pixel_size, 0.1f,
+                         0.0f, 16.0f);
+        ImGui::DragFloat("Min Occluder Screen Fraction",
+                         &min_occluder_screen_fraction, 0.005f, 0.0f, 1.0f);
+        ImGui::Text("Bodies drawn: %d, shadow casters: %d",
+                    (int)visible_bodies.size(), (int)shadow_casters.size());
+        ImGui::Text("Bodies culled: %d (frustum), %d (screen coverage)",
+                    num_frustum_culled, num_coverage_culled);
+        ImGui::Text("Body draw calls: %d", num_draw_calls);
+        if (!belts.empty()) {
+            ImGui::Separator();
+            AsteroidBelt::imgui_lod_controls();
+            for (AsteroidBelt* belt : belts) {
+                belt->imgui();
+            }
+        }
 
         ImGui::SliderInt("Selected Body", &selected_body, 0,
                          (int)bodies.size() - 1);
@@ -112,13 +161,92 @@ class PlanetSystem {
             // TODO: generalize for binary systems
             body->update((float)delta_time, bodies[0]->getPosition());
         }
+        for (AsteroidBelt* belt : belts) {
+            belt->update(delta_time, get_belt_center(*belt));
+        }
     }
 
+    // In config order, see CollisionWorld::update
+    const std::vector<Body*>& get_bodies() const { return bodies; }
+
+    void set_selected_body(int body) {
+        if (body >= 0 && body < (int)bodies.size()) selected_body = body;
+    }
+
+    // Index of the body closest along the ray, or -1. Shortens ray.t on a hit.
+    int pick(Ray& ray) const {
+        int picked = -1;
+        for (size_t i = 0; i < bodies.size(); i++) {
+            if (intersectRayWithSphere(ray, bodies[i]->getPosition(),
+                                       bodies[i]->getRadius())) {
+                picked = (int)i;
+            }
+        }
+        return picked;
+    }
+
+    // Builds the visible and shadow-caster lists for this frame. Does not
+    // touch any GL state.
+    void cull(const glm::mat4& view_matrix, const glm::mat4& projection_matrix,
+              const glm::vec3& camera_position, float screen_height) {
+        visible_bodies.clear();
+        visible_sizes.clear();
+        shadow_casters.clear();
+        num_frustum_culled = 0;
+        num_coverage_culled = 0;
+
+        Frustum frustum(projection_matrix * view_matrix);
+        float fov = glm::radians(config.camera_fov_degrees);
+        std::vector<std::pair<float, Body*>> sized_bodies;
+        for (Body* body : bodies) {
+            glm::vec3 center = body->getPosition();
+            float bounding_radius = body->get_bounding_radius();
+            float size = projected_sphere_size(center, bounding_radius,
+                                               camera_position, fov,
+                                               screen_height);
+            if (enable_culling) {
+                if (!frustum.intersects_sphere(center, bounding_radius)) {
+                    num_frustum_culled++;
+                    continue;
+                }
+                if (size < min_body_pixel_size) {
+                    num_coverage_culled++;
+                    continue;
+                }
+            }
+            sized_bodies.emplace_back(size, body);
+        }
+        // largest on screen first, they are the best occluders for the rest
+        std::stable_sort(sized_bodies.begin(), sized_bodies.end(),
+                         [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (const auto& [size, body] : sized_bodies) {
+            visible_bodies.push_back(body);
+            visible_sizes.push_back(size);
+            // the shadow map of a body is only sampled when drawing that body
+            // itself, so invisible bodies don't need one
+            if (body->needs_shadow_map()) {
+                shadow_casters.push_back(body);
+            }
+        }
+    }
+
+    // reset_opengl_state is called before every pass and must also rebind
+    // the render target. A reflection pass (EnvironmentProbe) reuses the
+    // shadow maps of the last regular pass and skips the asteroid belts;
+    // passing the probe resolution as screen_height lowers tessellation and
+    // culls small bodies on its own. With `occlusion`, bodies are tested
+    // largest first and skipped (shadow map included) while hidden behind
+    // the occluders drawn before them, see the regular draw pass.
     void draw(const glm::mat4& view_matrix, const glm::mat4& projection_matrix,
               const glm::vec3& camera_position, float screen_height,
-            void (*reset_opengl_state)()) {
+              const std::function<void()>& reset_opengl_state,
+              bool reflection_pass = false,
+              OcclusionCuller* occlusion = nullptr) {
+        cull(view_matrix, projection_matrix, camera_position, screen_height);
+
         float time = (float)glfwGetTime();
-        
+        num_draw_calls = 0;
+
         std::vector<glm::vec4> bodies_pos_rad;
         glm::vec4 sun_pos_rad(0.0f);
         for (Body* body : bodies) {
@@ -132,64 +260,126 @@ class PlanetSystem {
             }
         }
 
+        for (Body* body : visible_bodies) {
+            body->update_textures(time);
+        }
+
         // shadow map pass
-        for (Body* body : bodies) {
-            if (body->needs_shadow_map()) {
+        if (!reflection_pass) {
+            for (Body* body : shadow_casters) {
+                if (occlusion != nullptr && !occlusion->is_visible(body)) continue;
                 reset_opengl_state();
                 body->shader.bind();
-                glUniform1f(body->shader.getUniformLocation("screenHeight"),
-                            screen_height);
-                glUniform1f(body->shader.getUniformLocation("fov"),
-                            glm::radians(config.camera_fov_degrees));
-                glUniform1f(body->shader.getUniformLocation("time"), time);
-
-                glUniform1i(body->shader.getUniformLocation("binary_system"),
-                            0);
-                glUniform4fv(body->shader.getUniformLocation("sunPosRad"), 1,
-                             glm::value_ptr(sun_pos_rad));
-
-                glUniform1i(body->shader.getUniformLocation("num_bodies"),
-                            (GLint)bodies_pos_rad.size());
-                glUniform4fv(body->shader.getUniformLocation("bodyPosRadii"),
-                             (GLint)bodies_pos_rad.size(),
-                             glm::value_ptr(bodies_pos_rad[0]));
-                glUniform1i(body->shader.getUniformLocation("tessellate"),
-                            enable_body_tessellation);
-                glUniform1f(body->shader.getUniformLocation("targetPixelSize"),
-                            target_body_tessellation_triangle_height);
-                
+                set_frame_uniforms(body->shader, screen_height, time,
+                                   sun_pos_rad, bodies_pos_rad);
                 body->draw_depth();
+                num_draw_calls++;
             }
         }
 
-        // regular draw pass
-        for (Body* body : bodies) {
+        std::vector<Body*> batched_bodies;
+        auto draw_batch = [&]() {
+            if (batched_bodies.empty()) return;
             reset_opengl_state();
-            body->shader.bind();
-            glUniform1f(body->shader.getUniformLocation("screenHeight"),
-                        screen_height);
-            glUniform1f(body->shader.getUniformLocation("fov"),
-                        glm::radians(config.camera_fov_degrees));
-            glUniform1f(body->shader.getUniformLocation("time"), time);
-
-            glUniform1i(body->shader.getUniformLocation("binary_system"), 0);
-            glUniform4fv(body->shader.getUniformLocation("sunPosRad"), 1,
-                glm::value_ptr(sun_pos_rad));
-        
-            glUniform1i(body->shader.getUniformLocation("num_bodies"),
-                (GLint)bodies_pos_rad.size());
-            glUniform4fv(body->shader.getUniformLocation("bodyPosRadii"),
-                (GLint)bodies_pos_rad.size(), glm::value_ptr(bodies_pos_rad[0]));    
-            glUniform1i(body->shader.getUniformLocation("tessellate"),
-                        enable_body_tessellation);
-            glUniform1f(body->shader.getUniformLocation("targetPixelSize"),
-                        target_body_tessellation_triangle_height);
-            glUniform1i(body->shader.getUniformLocation("enable_eclipse"), enable_eclipse ? 1 : 0);
-            glUniform1i(body->shader.getUniformLocation("enable_shadowmapping"), enable_shadowmapping ? 1 : 0);
-            glUniform1i(body->shader.getUniformLocation("PCF_kernel_radius"), PCF_kernel_radius);
-            glUniform1i(body->shader.getUniformLocation("enable_PCF"), enable_PCF ? 1 : 0);
+            body_batch.shader.bind();
+            set_frame_uniforms(body_batch.shader, screen_height, time,
+                               sun_pos_rad, bodies_pos_rad);
+            set_shading_uniforms(body_batch.shader);
+            num_draw_calls += body_batch.draw(batched_bodies, view_matrix,
+                                              projection_matrix,
+                                              camera_position);
+            batched_bodies.clear();
+        };
 
+        // Regular draw pass. Unbatched bodies write depth as soon as they're
+        // drawn, batched ones only when their batch is. With occlusion the
+        // batch is therefore split once: the occluders (bodies covering
+        // min_occluder_screen_fraction of the screen) are drawn before the
+        // first smaller body is tested, so the smaller ones are tested
+        // against every occluder, though not against each other.
+        const float min_occluder_size = min_occluder_screen_fraction * screen_height;
+        bool occluders_drawn = false;
+        for (size_t i = 0; i < visible_bodies.size(); i++) {
+            Body* body = visible_bodies[i];
+            if (occlusion != nullptr) {
+                if (!occluders_drawn && visible_sizes[i] < min_occluder_size) {
+                    draw_batch();
+                    occluders_drawn = true;
+                }
+                reset_opengl_state();
+                if (!occlusion->test_sphere(body, body->getPosition(),
+                                            body->get_bounding_radius())) {
+                    continue;
+                }
+            }
+            if (body->is_batchable()) {
+                batched_bodies.push_back(body);
+                continue;
+            }
+            reset_opengl_state();
+            body->shader.bind();
+            set_frame_uniforms(body->shader, screen_height, time, sun_pos_rad,
+                               bodies_pos_rad);
+            set_shading_uniforms(body->shader);
             body->draw(view_matrix, projection_matrix, camera_position);
+            num_draw_calls++;
+        }
+
+        draw_batch();
+
+        if (reflection_pass) return;
+        glm::vec3 light_position =
+            bodies.empty() ? glm::vec3(0.0f) : bodies[0]->getPosition();
+        for (AsteroidBelt* belt : belts) {
+            reset_opengl_state();
+            num_draw_calls += belt->draw(
+                view_matrix, projection_matrix, camera_position,
+                glm::radians(config.camera_fov_degrees), screen_height,
+                light_position);
         }
     }
+
+   private:
+    glm::vec3 get_belt_center(const AsteroidBelt& belt) const {
+        int parent = belt.get_parent_id();
+        if (parent >= 0 && parent < (int)bodies.size()) {
+            return bodies[(size_t)parent]->getPosition();
+        }
+        return glm::vec3(0.0f);
+    }
+
+    // Uniforms shared by every body shader in both passes. Assumes the shader
+    // is already bound.
+    void set_frame_uniforms(const Shader& shader, float screen_height,
+                            float time, const glm::vec4& sun_pos_rad,
+                            const std::vector<glm::vec4>& bodies_pos_rad) {
+        glUniform1f(shader.getUniformLocation("screenHeight"), screen_height);
+        glUniform1f(shader.getUniformLocation("fov"),
+                    glm::radians(config.camera_fov_degrees));
+        glUniform1f(shader.getUniformLocation("time"), time);
+
+        glUniform1i(shader.getUniformLocation("binary_system"), 0);
+        glUniform4fv(shader.getUniformLocation("sunPosRad"), 1,
+                     glm::value_ptr(sun_pos_rad));
+
+        glUniform1i(shader.getUniformLocation("num_bodies"),
+                    (GLint)bodies_pos_rad.size());
+        if (!bodies_pos_rad.empty()) {
+            glUniform4fv(shader.getUniformLocation("bodyPosRadii"),
+                         (GLint)bodies_pos_rad.size(),
+                         glm::value_ptr(bodies_pos_rad[0]));
+        }
+        glUniform1i(shader.getUniformLocation("tessellate"),
+                    enable_body_tessellation);
+        glUniform1f(shader.getUniformLocation("targetPixelSize"),
+                    target_body_tessellation_triangle_height);
+    }
+
+    // Lighting toggles only used by the regular draw pass.
+    void set_shading_uniforms(const Shader& shader) {
+        glUniform1i(shader.getUniformLocation("enable_eclipse"), enable_eclipse ? 1 : 0);
+        glUniform1i(shader.getUniformLocation("enable_shadowmapping"), enable_shadowmapping ? 1 : 0);
+        glUniform1i(shader.getUniformLocation("PCF_kernel_radius"), PCF_kernel_radius);
+        glUniform1i(shader.getUniformLocation("enable_PCF"), enable_PCF ? 1 : 0);
+    }
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include "core/AnimatedCubemap.h"
 #include "scene/bodies/Body.h"
 
 class Star : public Body {
@@ -6,7 +7,10 @@ class Star : public Body {
     // TODO: load star params from config instead of insane imgui
     Star(Config& config, const glm::vec3& pos, float r,
          GPUMesh& icosahedron_mesh)
-        : Body(config, pos, r, icosahedron_mesh) {}
+        : Body(config, pos, r, icosahedron_mesh),
+          surface(config.star_surface_resolution, GL_R16F),
+          surface_update_rate(config.star_surface_update_rate),
+          surface_interpolate(config.star_surface_interpolate) {}
 
     void setup() {
         ShaderBuilder starBuilder;
@@ -19,32 +23,62 @@ class Star : public Body {
         starBuilder.addStage(GL_FRAGMENT_SHADER,
                             RESOURCE_ROOT "shaders/bodies/star_frag.glsl");
         shader = starBuilder.build();
+
+        try {
+            ShaderBuilder bakeBuilder;
+            bakeBuilder.addStage(GL_VERTEX_SHADER,
+                                 RESOURCE_ROOT "shaders/fullscreen_vert.glsl");
+            bakeBuilder.addStage(GL_FRAGMENT_SHADER,
+                                 RESOURCE_ROOT "shaders/bodies/star_bake_frag.glsl");
+            bake_shader = bakeBuilder.build();
+        } catch (const ShaderLoadingException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Bakes the due faces of the surface noise cube map, see AnimatedCubemap
+    void update_textures(float time) {
+        bake_shader.bind();
+        glUniform1i(bake_shader.getUniformLocation("OCTAVES"), noise_octaves);
+        glUniform1f(bake_shader.getUniformLocation("LACUNARITY"), noise_lacunarity);
+        glUniform1f(bake_shader.getUniformLocation("PERSISTENCE"), noise_persistence);
+        glUniform1f(bake_shader.getUniformLocation("warp_noise_scale"), warp_noise_scale);
+        glUniform1f(bake_shader.getUniformLocation("noise_scale"), noise_scale);
+        glUniform1f(bake_shader.getUniformLocation("animation_speed"), animation_speed);
+        surface.update(time, surface_update_rate, bake_shader);
+        surface_blend = surface_interpolate ? surface.get_blend(time) : 0.0f;
     }
 
     void update(float deltaTime) {
         Body::update(deltaTime);
     }
 
+    bool is_batchable() const { return false; }
+
     void imGuiControl() {
         Body::imGuiControl();
         ImGui::Separator();
         ImGui::Text("Star Surface Noise Controls");
-        ImGui::SliderInt("Noise Octaves", &noise_octaves, 1, 10);
-        ImGui::SliderFloat("Noise Lacunarity", &noise_lacunarity, 1.0f, 4.0f);
-        ImGui::SliderFloat("Noise Persistence", &noise_persistence, 0.1f, 1.0f);
-        ImGui::SliderFloat("Warp Noise Scale", &warp_noise_scale, 0.1f, 5.0f);
-        ImGui::SliderFloat("Noise Scale", &noise_scale, 1.0f, 100.0f);
-        ImGui::SliderFloat("Animation Speed", &animation_speed, 0.1f, 1.0f);
+        bool changed = false;
+        changed |= ImGui::SliderInt("Noise Octaves", &noise_octaves, 1, 10);
+        changed |= ImGui::SliderFloat("Noise Lacunarity", &noise_lacunarity, 1.0f, 4.0f);
+        changed |= ImGui::SliderFloat("Noise Persistence", &noise_persistence, 0.1f, 1.0f);
+        changed |= ImGui::SliderFloat("Warp Noise Scale", &warp_noise_scale, 0.1f, 5.0f);
+        changed |= ImGui::SliderFloat("Noise Scale", &noise_scale, 1.0f, 100.0f);
+        changed |= ImGui::SliderFloat("Animation Speed", &animation_speed, 0.1f, 1.0f);
+        if (changed) surface.invalidate();
+        ImGui::SliderFloat("Surface Update Rate (Hz)", &surface_update_rate, 1.0f, 60.0f);
+        ImGui::Checkbox("Interpolate Surface Updates", &surface_interpolate);
+        ImGui::Text("Surface: %d^2 x 6, %d faces baked this frame",
+                    surface.get_resolution(), surface.get_faces_baked());
     }
 
     void set_uniforms() { // this assumes the shader is already bound
         Body::set_uniforms();
-        glUniform1i(shader.getUniformLocation("OCTAVES"), noise_octaves);
-        glUniform1f(shader.getUniformLocation("LACUNARITY"), noise_lacunarity);
-        glUniform1f(shader.getUniformLocation("PERSISTENCE"), noise_persistence);
-        glUniform1f(shader.getUniformLocation("warp_noise_scale"), warp_noise_scale);
-        glUniform1f(shader.getUniformLocation("noise_scale"), noise_scale);
-        glUniform1f(shader.getUniformLocation("animation_speed"), animation_speed);
+        surface.bind_for_reading(GL_TEXTURE1, GL_TEXTURE2);
+        glUniform1i(shader.getUniformLocation("surfacePrev"), 1);
+        glUniform1i(shader.getUniformLocation("surfaceNext"), 2);
+        glUniform1f(shader.getUniformLocation("surfaceBlend"), surface_blend);
     }
 
    protected:
@@ -55,4 +89,11 @@ class Star : public Body {
     float warp_noise_scale = 1.5f;
     float noise_scale = 20.0f;
     float animation_speed = 0.3f;
+
+    // baked surface
+    Shader bake_shader;
+    AnimatedCubemap surface;
+    float surface_update_rate;
+    bool surface_interpolate;
+    float surface_blend = 0.0f;
 };
\ No newline at end of file
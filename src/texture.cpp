@@ -2,17 +2,71 @@
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
 #include <fmt/format.h>
+#include <stb/stb_image.h>
 DISABLE_WARNINGS_POP()
 #include <framework/image.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <limits>
+#include <string>
+
+static std::optional<KtxFile> loadCompressed(const std::filesystem::path& filePath)
+{
+    const std::filesystem::path ktxPath = std::filesystem::path(filePath).replace_extension(".ktx");
+    if (filePath.extension() != ".ktx" && !std::filesystem::exists(ktxPath))
+        return std::nullopt;
+
+    std::optional<KtxFile> ktx = read_ktx(ktxPath);
+    if (ktx && ktx->faces != 1) {
+        std::cerr << ktxPath << " is a cube map, not a 2D texture" << std::endl;
+        ktx.reset();
+    } else if (ktx && !is_compressed_format_supported(ktx->internal_format)) {
+        std::cerr << "Compressed format of " << ktxPath << " is not supported by the driver" << std::endl;
+        ktx.reset();
+    }
+    if (!ktx && filePath.extension() == ".ktx")
+        throw ImageLoadingException(fmt::format("Failed to load compressed texture {}", filePath.string()));
+    return ktx;
+}
 
 Texture::Texture(std::filesystem::path filePath)
 {
-    // Load image from disk to CPU memory.
-    // Image class is defined in <framework/image.h>
-    Image cpuTexture { filePath };
+    if (const std::optional<KtxFile> ktx = loadCompressed(filePath)) {
+        upload(*ktx);
+        return;
+    }
+    // Load image from disk to CPU memory, Image is defined in <framework/image.h>
+    upload(Image { filePath });
+}
+
+Texture::Texture(const KtxFile& ktx)
+{
+    upload(ktx);
+}
 
+Texture::Texture(const Image& cpuTexture)
+{
+    upload(cpuTexture);
+}
+
+void Texture::upload(const KtxFile& ktx)
+{
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // The mip chain was built offline, there's nothing to generate
+    upload_ktx(ktx);
+}
+
+void Texture::upload(const Image& cpuTexture)
+{
     // Create a texture on the GPU and bind it for parameter setting
     glGenTextures(1, &m_texture);
     glBindTexture(GL_TEXTURE_2D, m_texture);
@@ -62,3 +116,79 @@ void Texture::bind(GLint textureSlot)
     glActiveTexture(textureSlot);
     glBindTexture(GL_TEXTURE_2D, m_texture);
 }
+
+std::vector<std::optional<Image>> decodeImages(const std::vector<std::filesystem::path>& filePaths,
+                                               ThreadPool& threadPool, int desiredChannels)
+{
+    std::vector<std::optional<Image>> images(filePaths.size());
+    threadPool.parallel_for(static_cast<int>(filePaths.size()), 1, [&](int begin, int end) {
+        for (size_t i = size_t(begin); i < size_t(end); i++) {
+            try {
+                images[i].emplace(filePaths[i], desiredChannels);
+            } catch (const std::exception&) {
+                // Image already reported the file
+            }
+        }
+    });
+    return images;
+}
+
+static float elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmarkImageDecoding(std::ostream& out)
+{
+    // the skybox faces when they're there, otherwise a stand-in of the same count
+    std::vector<std::filesystem::path> filePaths;
+    for (const char* face : { "px", "nx", "py", "ny", "pz", "nz" }) {
+        const std::filesystem::path path = std::filesystem::path(RESOURCE_ROOT "resources/skybox") / (std::string(face) + ".png");
+        filePaths.push_back(std::filesystem::exists(path) ? path : std::filesystem::path(RESOURCE_ROOT "resources/checkerboard.png"));
+    }
+    constexpr int REPEATS = 5;
+    ThreadPool threadPool;
+
+    // Image before it kept the stb buffer: decode, then copy byte by byte
+    auto copyPerByte = [&]() {
+        size_t bytes = 0;
+        for (const auto& path : filePaths) {
+            int width, height, channels;
+            stbi_uc* stbPixels = stbi_load(path.string().c_str(), &width, &height, &channels, 3);
+            std::vector<uint8_t> pixels;
+            for (size_t i = 0; i < size_t(width) * size_t(height) * 3; i++)
+                pixels.emplace_back(stbPixels[i]);
+            stbi_image_free(stbPixels);
+            bytes += pixels.size();
+        }
+        return bytes;
+    };
+    auto ownedSerial = [&]() {
+        size_t bytes = 0;
+        for (const auto& path : filePaths)
+            bytes += Image(path, 3).get_byte_size();
+        return bytes;
+    };
+    auto ownedParallel = [&]() {
+        size_t bytes = 0;
+        for (const auto& image : decodeImages(filePaths, threadPool, 3))
+            bytes += image ? image->get_byte_size() : 0;
+        return bytes;
+    };
+
+    out << "Decoding " << filePaths.size() << " cubemap faces (" << threadPool.get_thread_count() + 1
+        << " threads), best of " << REPEATS << "\n";
+    auto run = [&](const char* name, auto&& decode) {
+        float best = std::numeric_limits<float>::max();
+        size_t bytes = 0;
+        for (int repeat = 0; repeat < REPEATS; repeat++) {
+            auto start = std::chrono::steady_clock::now();
+            bytes = decode();
+            best = std::min(best, elapsedMs(start));
+        }
+        out << fmt::format("  {:<32} {:8.2f} ms  ({:.1f} MB)\n", name, best, double(bytes) / (1024.0 * 1024.0));
+    };
+    run("serial, per-byte copy (before)", copyPerByte);
+    run("serial, owned stb buffer", ownedSerial);
+    run("parallel, owned stb buffer", ownedParallel);
+}
@@ -5,15 +5,29 @@ DISABLE_WARNINGS_PUSH()
 DISABLE_WARNINGS_POP()
 #include <exception>
 #include <filesystem>
+#include <optional>
+#include <ostream>
+#include <vector>
+#include <framework/image.h>
 #include <framework/opengl_includes.h>
 
+#include "core/KtxFile.h"
+#include "core/ThreadPool.h"
+
 struct ImageLoadingException : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
 class Texture {
 public:
+    // Loads a .ktx file made by TextureConverter directly. For any other
+    // image, a compressed copy next to it (same name, .ktx extension) is
+    // preferred when the driver supports its format.
     Texture(std::filesystem::path filePath);
+    // Uploads an image decoded beforehand, e.g. by decodeImages
+    explicit Texture(const Image& image);
+    // Uploads the compressed mip chain as is
+    explicit Texture(const KtxFile& ktx);
     Texture(const Texture&) = delete;
     Texture(Texture&&);
     ~Texture();
@@ -24,6 +38,19 @@ public:
     void bind(GLint textureSlot);
 
 private:
+    void upload(const Image& cpuTexture);
+    void upload(const KtxFile& ktx);
+
     static constexpr GLuint INVALID = 0xFFFFFFFF;
     GLuint m_texture { INVALID };
 };
+
+// Decodes independent images on the thread pool, one job per file, and
+// returns them in the order of `filePaths`. Files that fail to decode are
+// reported and left empty.
+std::vector<std::optional<Image>> decodeImages(const std::vector<std::filesystem::path>& filePaths,
+                                               ThreadPool& threadPool, int desiredChannels = 0);
+
+// Headless startup-time comparison of the skybox decode: serial with the old
+// per-byte pixel copy, serial into owned stb buffers, and in parallel
+void benchmarkImageDecoding(std::ostream& out);
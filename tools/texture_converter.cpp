@@ -0,0 +1,194 @@
+// Offline converter from images to block-compressed KTX textures with their
+// mip chains precomputed, which Texture and Skybox upload without decoding or
+// generating anything at startup:
+//
+//   TextureConverter [--bc1 | --bc3] [--no-mipmaps] <image> <output.ktx>
+//   TextureConverter --cubemap [--bc1 | --bc3] [--no-mipmaps] <px> <nx> <py> <ny> <pz> <nz> <output.ktx>
+//
+// BC1 (DXT1, 4 bits per pixel) is used for images that are fully opaque and
+// BC3 (DXT5, 8 bits per pixel) for the others, unless a format is given.
+// Both are S3TC formats, which every desktop OpenGL 4.1 driver samples.
+#include "core/KtxFile.h"
+#include "core/ThreadPool.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+DISABLE_WARNINGS_POP()
+#include <framework/image.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct RgbaLevel {
+    int width, height;
+    std::vector<uint8_t> pixels; // RGBA8, row by row
+};
+
+RgbaLevel loadRgba(const std::filesystem::path& filePath)
+{
+    const Image image { filePath, 4 };
+    const uint8_t* pixels = image.get_data();
+    return { image.width, image.height, std::vector<uint8_t>(pixels, pixels + image.get_byte_size()) };
+}
+
+bool isOpaque(const RgbaLevel& level)
+{
+    for (size_t i = 3; i < level.pixels.size(); i += 4) {
+        if (level.pixels[i] != 255)
+            return false;
+    }
+    return true;
+}
+
+// Box filter to half the size, rounded down to at least one pixel. The last
+// row or column of an odd sized level is clamped to the edge.
+RgbaLevel downsample(const RgbaLevel& source)
+{
+    RgbaLevel result { std::max(source.width / 2, 1), std::max(source.height / 2, 1), {} };
+    result.pixels.resize(size_t(result.width) * size_t(result.height) * 4);
+    for (int y = 0; y < result.height; y++) {
+        const int y0 = std::min(2 * y, source.height - 1);
+        const int y1 = std::min(2 * y + 1, source.height - 1);
+        for (int x = 0; x < result.width; x++) {
+            const int x0 = std::min(2 * x, source.width - 1);
+            const int x1 = std::min(2 * x + 1, source.width - 1);
+            for (int c = 0; c < 4; c++) {
+                auto at = [&](int sx, int sy) { return int(source.pixels[(size_t(sy) * size_t(source.width) + size_t(sx)) * 4 + size_t(c)]); };
+                const int sum = at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1);
+                result.pixels[(size_t(y) * size_t(result.width) + size_t(x)) * 4 + size_t(c)] = uint8_t((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+// Compresses rows of 4x4 blocks in parallel. Blocks past the edge of levels
+// smaller than a block repeat the edge pixels.
+std::vector<uint8_t> compress(const RgbaLevel& level, GLenum format, ThreadPool& threadPool)
+{
+    const bool alpha = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    const int blocksX = (level.width + 3) / 4;
+    const int blocksY = (level.height + 3) / 4;
+    const size_t blockBytes = alpha ? 16 : 8;
+    std::vector<uint8_t> result(compressed_level_size(format, level.width, level.height));
+
+    threadPool.parallel_for(blocksY, 4, [&](int begin, int end) {
+        std::array<uint8_t, 4 * 4 * 4> block;
+        for (int blockY = begin; blockY < end; blockY++) {
+            for (int blockX = 0; blockX < blocksX; blockX++) {
+                for (int y = 0; y < 4; y++) {
+                    const int sy = std::min(blockY * 4 + y, level.height - 1);
+                    for (int x = 0; x < 4; x++) {
+                        const int sx = std::min(blockX * 4 + x, level.width - 1);
+                        std::copy_n(&level.pixels[(size_t(sy) * size_t(level.width) + size_t(sx)) * 4], 4, &block[size_t(y * 4 + x) * 4]);
+                    }
+                }
+                uint8_t* dest = &result[(size_t(blockY) * size_t(blocksX) + size_t(blockX)) * blockBytes];
+                stb_compress_dxt_block(dest, block.data(), alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+            }
+        }
+    });
+    return result;
+}
+
+int printUsage()
+{
+    std::cerr << "Usage:\n"
+              << "  TextureConverter [--bc1 | --bc3] [--no-mipmaps] <image> <output.ktx>\n"
+              << "  TextureConverter --cubemap [--bc1 | --bc3] [--no-mipmaps] <px> <nx> <py> <ny> <pz> <nz> <output.ktx>\n";
+    return 1;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bool cubemap = false;
+    bool mipmaps = true;
+    GLenum format = 0; // pick by alpha
+    std::vector<std::filesystem::path> paths;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--cubemap")
+            cubemap = true;
+        else if (arg == "--no-mipmaps")
+            mipmaps = false;
+        else if (arg == "--bc1")
+            format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        else if (arg == "--bc3")
+            format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        else if (arg.starts_with("--"))
+            return printUsage();
+        else
+            paths.emplace_back(arg);
+    }
+    const size_t numFaces = cubemap ? 6 : 1;
+    if (paths.size() != numFaces + 1)
+        return printUsage();
+    const std::filesystem::path outputPath = paths.back();
+    paths.pop_back();
+
+    std::vector<RgbaLevel> faces;
+    try {
+        for (const auto& path : paths)
+            faces.push_back(loadRgba(path));
+    } catch (const std::exception&) {
+        // Image already reported the file
+        return 1;
+    }
+    for (const RgbaLevel& face : faces) {
+        if (face.width != faces[0].width || face.height != faces[0].height || (cubemap && face.width != face.height)) {
+            std::cerr << "Cube map faces must be square and all the same size" << std::endl;
+            return 1;
+        }
+    }
+    if (format == 0) {
+        const bool opaque = std::all_of(faces.begin(), faces.end(), isOpaque);
+        format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+
+    KtxFile ktx;
+    ktx.internal_format = format;
+    ktx.base_internal_format = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? GL_RGB : GL_RGBA;
+    ktx.width = faces[0].width;
+    ktx.height = faces[0].height;
+    ktx.faces = static_cast<int>(numFaces);
+
+    ThreadPool threadPool;
+    size_t uncompressedBytes = 0;
+    while (true) {
+        std::vector<uint8_t>& level = ktx.levels.emplace_back();
+        for (const RgbaLevel& face : faces) {
+            const std::vector<uint8_t> blocks = compress(face, format, threadPool);
+            level.insert(level.end(), blocks.begin(), blocks.end());
+            uncompressedBytes += size_t(face.width) * size_t(face.height) * (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 3u : 4u);
+        }
+        if (!mipmaps || (faces[0].width == 1 && faces[0].height == 1))
+            break;
+        for (RgbaLevel& face : faces)
+            face = downsample(face);
+    }
+
+    if (!write_ktx(outputPath, ktx))
+        return 1;
+
+    size_t compressedBytes = 0;
+    for (const auto& level : ktx.levels)
+        compressedBytes += level.size();
+    std::cout << fmt::format("{} {}x{}{} -> {}, {} levels, {:.2f} MB ({:.2f} MB uncompressed, {:.1f}x smaller)\n",
+        outputPath.string(), ktx.width, ktx.height, cubemap ? " cube map" : "",
+        format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? "BC1" : "BC3", ktx.levels.size(),
+        double(compressedBytes) / (1024.0 * 1024.0), double(uncompressedBytes) / (1024.0 * 1024.0),
+        double(uncompressedBytes) / double(compressedBytes));
+    return 0;
+}